@@ -0,0 +1,111 @@
+#include "devices/clock.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/pit.h"
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+
+/* High-resolution clock source.
+
+   If the CPU has a time stamp counter, its rate is calibrated
+   once at boot against the PIT, and clock_ns() converts the
+   number of TSC cycles since boot into nanoseconds.  Without a
+   TSC, the clock falls back to the timer tick count, so it is
+   only as precise as TIMER_FREQ allows. */
+
+/* Length of the TSC calibration interval, in PIT cycles (10 ms). */
+#define CALIBRATE_PIT_COUNT (PIT_HZ / 100)
+
+static bool has_tsc;      /* Is the TSC usable? */
+static uint64_t tsc_hz;   /* TSC cycles per second. */
+static uint64_t tsc_base; /* TSC value at clock_init(). */
+
+/* Converting a cycle count C to nanoseconds computes
+   C * NSEC_PER_SEC / tsc_hz as (C * tsc_mult) >> tsc_shift,
+   where tsc_mult fits in 32 bits, to avoid a 64-bit division on
+   every read. */
+static uint32_t tsc_mult;
+static int tsc_shift;
+
+/* Detects the TSC and calibrates its rate against the PIT.  Must
+   be called before interrupts are enabled, while nothing else
+   is using PIT channel 2. */
+void clock_init(void) {
+  uint64_t start, end;
+  int shift;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  has_tsc = cpu_has_features(CPUID_1_EDX_TSC);
+  if (!has_tsc) {
+    printf("Clock: no TSC, using %d Hz timer ticks.\n", TIMER_FREQ);
+    return;
+  }
+
+  start = rdtsc();
+  pit_busy_wait(CALIBRATE_PIT_COUNT);
+  end = rdtsc();
+  tsc_hz = (end - start) * PIT_HZ / CALIBRATE_PIT_COUNT;
+  if (tsc_hz == 0) {
+    has_tsc = false;
+    printf("Clock: TSC is not running, using %d Hz timer ticks.\n", TIMER_FREQ);
+    return;
+  }
+
+  /* Pick the largest shift for which the multiplier still fits
+     in 32 bits, for the best precision. */
+  for (shift = 32; shift > 0; shift--)
+    if (((uint64_t)NSEC_PER_SEC << shift) / tsc_hz <= UINT32_MAX)
+      break;
+  tsc_shift = shift;
+  tsc_mult = ((uint64_t)NSEC_PER_SEC << shift) / tsc_hz;
+  tsc_base = end;
+
+  printf("Clock: %'" PRIu64 " kHz TSC.\n", tsc_hz / 1000);
+}
+
+/* Returns the number of nanoseconds since clock_init(). */
+uint64_t clock_ns(void) {
+  if (has_tsc)
+    return clock_cycles_to_ns(rdtsc() - tsc_base);
+  return (uint64_t)timer_ticks() * (NSEC_PER_SEC / TIMER_FREQ);
+}
+
+/* Returns a raw, monotonically increasing cycle count suitable
+   for cheap timestamps, which clock_cycles_to_ns() converts to
+   nanoseconds.  Without a TSC, counts timer ticks. */
+uint64_t clock_cycles(void) { return has_tsc ? rdtsc() : (uint64_t)timer_ticks(); }
+
+/* Converts CYCLES, a difference between two clock_cycles()
+   values, to nanoseconds. */
+uint64_t clock_cycles_to_ns(uint64_t cycles) {
+  uint64_t lo, hi;
+
+  if (!has_tsc)
+    return cycles * (NSEC_PER_SEC / TIMER_FREQ);
+
+  /* (CYCLES * tsc_mult) >> tsc_shift, without overflowing 64
+     bits, by splitting CYCLES into 32-bit halves. */
+  lo = ((cycles & UINT32_MAX) * tsc_mult) >> tsc_shift;
+  hi = ((cycles >> 32) * tsc_mult) << (32 - tsc_shift);
+  return hi + lo;
+}
+
+/* Returns true if the clock is driven by the TSC. */
+bool clock_has_tsc(void) { return has_tsc; }
+
+/* Returns the calibrated TSC rate in Hz, or 0 without a TSC. */
+uint64_t clock_tsc_hz(void) { return tsc_hz; }
+
+/* Busy-waits for approximately NS nanoseconds.  Interrupts need
+   not be turned on.  Requires a TSC; without one, use
+   timer_ndelay(). */
+void clock_ndelay(uint64_t ns) {
+  uint64_t start = rdtsc();
+
+  ASSERT(has_tsc);
+  while (clock_cycles_to_ns(rdtsc() - start) < ns)
+    continue;
+}
@@ -0,0 +1,23 @@
+#ifndef DEVICES_CLOCK_H
+#define DEVICES_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Nanoseconds per second. */
+#define NSEC_PER_SEC 1000000000
+
+void clock_init(void);
+
+/* High-resolution time since boot. */
+uint64_t clock_ns(void);
+uint64_t clock_cycles(void);
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+/* Clock source properties. */
+bool clock_has_tsc(void);
+uint64_t clock_tsc_hz(void);
+
+void clock_ndelay(uint64_t ns);
+
+#endif /* devices/clock.h */
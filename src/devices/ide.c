@@ -6,6 +6,7 @@
 #include "devices/block.h"
 #include "devices/partition.h"
 #include "devices/timer.h"
+#include "threads/defer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
@@ -70,6 +71,11 @@ struct channel {
                                    any interrupt would be spurious. */
   struct semaphore completion_wait; /* Up'd by interrupt handler. */
 
+  /* Unexpected interrupts are reported by the worker thread,
+     not the interrupt handler, because printing is slow. */
+  unsigned unexpected_cnt;          /* Not yet reported. */
+  struct deferred_work report_work; /* Reports them. */
+
   struct ata_disk devices[2]; /* The devices on this channel. */
 };
 
@@ -94,6 +100,7 @@ static void select_device(const struct ata_disk*);
 static void select_device_wait(const struct ata_disk*);
 
 static void interrupt_handler(struct intr_frame*);
+static defer_func report_unexpected;
 
 /* Initialize the disk subsystem and detect disks. */
 void ide_init(void) {
@@ -120,6 +127,8 @@ void ide_init(void) {
     lock_init(&c->lock);
     c->expecting_interrupt = false;
     sema_init(&c->completion_wait, 0);
+    c->unexpected_cnt = 0;
+    deferred_work_init(&c->report_work, report_unexpected, c);
 
     /* Initialize devices. */
     for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -452,10 +461,30 @@ static void interrupt_handler(struct intr_frame* f) {
       if (c->expecting_interrupt) {
         inb(reg_status(c));           /* Acknowledge interrupt. */
         sema_up(&c->completion_wait); /* Wake up waiter. */
-      } else
-        printf("%s: unexpected interrupt\n", c->name);
+      } else {
+        c->unexpected_cnt++;
+        defer_to_worker(&c->report_work);
+      }
       return;
     }
 
   NOT_REACHED();
 }
+
+/* Reports the unexpected interrupts on channel C_.  Deferred work
+   run by the worker thread. */
+static void report_unexpected(void* c_) {
+  struct channel* c = c_;
+  enum intr_level old_level;
+  unsigned cnt;
+
+  old_level = intr_disable();
+  cnt = c->unexpected_cnt;
+  c->unexpected_cnt = 0;
+  intr_set_level(old_level);
+
+  if (cnt == 1)
+    printf("%s: unexpected interrupt\n", c->name);
+  else if (cnt > 1)
+    printf("%s: %u unexpected interrupts\n", c->name, cnt);
+}
@@ -5,6 +5,7 @@
 #include <string.h>
 #include "devices/input.h"
 #include "devices/shutdown.h"
+#include "threads/defer.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 
@@ -24,10 +25,25 @@ static bool caps_lock;
 /* Number of keys pressed. */
 static int64_t key_cnt;
 
+/* Scancodes read by the keyboard interrupt but not yet
+   interpreted.  The interrupt only reads the scancode from the
+   controller and defers interpreting it to the interrupt's
+   return. */
+#define SCANCODE_BUF_SIZE 16 /* Must be a power of 2. */
+static unsigned scancode_buf[SCANCODE_BUF_SIZE];
+static unsigned scancode_head; /* Number of scancodes ever stored. */
+static unsigned scancode_tail; /* Number of scancodes ever interpreted. */
+static struct deferred_work scancode_work;
+
 static intr_handler_func keyboard_interrupt;
+static defer_func interpret_scancodes;
+static void interpret_scancode(unsigned code);
 
 /* Initializes the keyboard. */
-void kbd_init(void) { intr_register_ext(0x21, keyboard_interrupt, "8042 Keyboard"); }
+void kbd_init(void) {
+  deferred_work_init(&scancode_work, interpret_scancodes, NULL);
+  intr_register_ext(0x21, keyboard_interrupt, "8042 Keyboard");
+}
 
 /* Prints keyboard statistics. */
 void kbd_print_stats(void) { printf("Keyboard: %lld keys pressed\n", key_cnt); }
@@ -66,25 +82,52 @@ static const struct keymap shifted_keymap[] = {
 static bool map_key(const struct keymap[], unsigned scancode, uint8_t*);
 
 static void keyboard_interrupt(struct intr_frame* args UNUSED) {
+  /* Keyboard scancode. */
+  unsigned code;
+
+  /* Read scancode, including second byte if prefix code. */
+  code = inb(DATA_REG);
+  if (code == 0xe0)
+    code = (code << 8) | inb(DATA_REG);
+
+  /* Queue it for interpretation, dropping it if the buffer is
+     full. */
+  if (scancode_head - scancode_tail < SCANCODE_BUF_SIZE)
+    scancode_buf[scancode_head++ % SCANCODE_BUF_SIZE] = code;
+  defer_on_return(&scancode_work);
+}
+
+/* Interprets the scancodes the keyboard interrupt has queued,
+   with interrupts off for one at a time.  Deferred work run by
+   the keyboard interrupt. */
+static void interpret_scancodes(void* aux UNUSED) {
+  for (;;) {
+    enum intr_level old_level = intr_disable();
+    bool empty = scancode_head == scancode_tail;
+
+    if (!empty)
+      interpret_scancode(scancode_buf[scancode_tail++ % SCANCODE_BUF_SIZE]);
+    intr_set_level(old_level);
+    if (empty)
+      break;
+  }
+}
+
+/* Updates the shift state or appends a character to the input
+   buffer, as scancode CODE requires.  Must be called with
+   interrupts off. */
+static void interpret_scancode(unsigned code) {
   /* Status of shift keys. */
   bool shift = left_shift || right_shift;
   bool alt = left_alt || right_alt;
   bool ctrl = left_ctrl || right_ctrl;
 
-  /* Keyboard scancode. */
-  unsigned code;
-
   /* False if key pressed, true if key released. */
   bool release;
 
   /* Character that corresponds to `code'. */
   uint8_t c;
 
-  /* Read scancode, including second byte if prefix code. */
-  code = inb(DATA_REG);
-  if (code == 0xe0)
-    code = (code << 8) | inb(DATA_REG);
-
   /* Bit 0x80 distinguishes key press from key release
      (even if there's a prefix). */
   release = (code & 0x80) != 0;
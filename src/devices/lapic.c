@@ -0,0 +1,244 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/clock.h"
+#include "devices/pit.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Interface to the local APIC, the per-CPU interrupt controller
+   built into every x86 processor since the P6.  Pintos still
+   takes device interrupts through the 8259A PICs, so the local
+   APIC is kept in "virtual wire" mode, passing PIC interrupts
+   through on LINT0, and is otherwise used for its timer, which
+   delivers one-shot interrupts with far finer resolution than
+   the PIT's timer ticks, and for starting and signaling the
+   other CPUs of a multiprocessor.  See [IA32-v3a] chapter 10
+   "Advanced Programmable Interrupt Controller (APIC)". */
+
+/* IA32_APIC_BASE model-specific register. */
+#define MSR_APIC_BASE 0x1b
+#define APIC_BASE_ENABLE 0x800    /* Global enable. */
+#define APIC_BASE_ADDR 0xfffff000 /* Physical address of registers. */
+
+/* Register offsets. */
+#define LAPIC_ID 0x020         /* Local APIC ID. */
+#define LAPIC_TPR 0x080        /* Task priority. */
+#define LAPIC_EOI 0x0b0        /* End of interrupt. */
+#define LAPIC_SVR 0x0f0        /* Spurious interrupt vector. */
+#define LAPIC_ICR_LO 0x300     /* Interrupt command, low half. */
+#define LAPIC_ICR_HI 0x310     /* Interrupt command, high half. */
+#define LAPIC_LVT_TIMER 0x320  /* Local vector table: timer. */
+#define LAPIC_LVT_LINT0 0x350  /* Local vector table: LINT0 pin. */
+#define LAPIC_LVT_LINT1 0x360  /* Local vector table: LINT1 pin. */
+#define LAPIC_LVT_ERROR 0x370  /* Local vector table: errors. */
+#define LAPIC_TIMER_INIT 0x380 /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390  /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0  /* Timer divide configuration. */
+
+/* Register bits. */
+#define SVR_ENABLE 0x100     /* Software enable. */
+#define LVT_MASKED 0x10000   /* Interrupt masked. */
+#define LVT_NMI 0x400        /* Delivery mode: NMI. */
+#define LVT_EXTINT 0x700     /* Delivery mode: external (PIC). */
+#define LVT_PERIODIC 0x20000 /* Timer mode: periodic. */
+#define TIMER_DIV_16 0x3     /* Timer counts at bus clock / 16. */
+#define ICR_FIXED 0x000      /* Delivery mode: fixed vector. */
+#define ICR_INIT 0x500       /* Delivery mode: INIT. */
+#define ICR_STARTUP 0x600    /* Delivery mode: start-up (SIPI). */
+#define ICR_PENDING 0x1000   /* Delivery status: send pending. */
+#define ICR_ASSERT 0x4000    /* Level: assert. */
+#define ICR_LEVEL 0x8000     /* Trigger mode: level. */
+
+/* Kernel virtual address at which the registers are mapped.
+   Physical memory is mapped starting at PHYS_BASE, so this is
+   far above any RAM. */
+#define LAPIC_VADDR ((volatile uint32_t*)0xfffff000)
+
+/* Length of the timer calibration interval, in PIT cycles (10
+   ms). */
+#define CALIBRATE_PIT_COUNT (PIT_HZ / 100)
+
+static bool present;      /* Is the local APIC enabled? */
+static uint64_t timer_hz; /* Timer counts per second. */
+
+static intr_handler_func spurious_interrupt;
+
+/* Reads the local APIC register at byte offset REG. */
+static inline uint32_t lapic_read(int reg) { return LAPIC_VADDR[reg / 4]; }
+
+/* Writes VALUE to the local APIC register at byte offset REG. */
+static inline void lapic_write(int reg, uint32_t value) { LAPIC_VADDR[reg / 4] = value; }
+
+/* Maps the 4 kB page of registers at physical address PADDR at
+   LAPIC_VADDR in the kernel page table, uncached.  Page
+   directories for user processes copy the kernel's mappings when
+   they are created, so this must happen before any process
+   starts. */
+static void map_registers(uintptr_t paddr) {
+  uint32_t* pd = init_page_dir;
+  uint32_t* pt;
+  void* vaddr = (void*)LAPIC_VADDR;
+
+  if (pd[pd_no(vaddr)] == 0)
+    pd[pd_no(vaddr)] = pde_create(palloc_get_page(PAL_ASSERT | PAL_ZERO));
+  pt = pde_get_pt(pd[pd_no(vaddr)]);
+  pt[pt_no(vaddr)] = (paddr & PTE_ADDR) | PTE_PCD | PTE_PWT | PTE_W | PTE_P;
+  asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
+}
+
+/* Enables the local APIC, if the CPU has one, and calibrates its
+   timer against the PIT.  Must be called after paging_init() and
+   intr_init(), with interrupts off. */
+void lapic_init(void) {
+  uint64_t base;
+  uint32_t elapsed;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (!cpu_has_features(CPUID_1_EDX_APIC | CPUID_1_EDX_MSR)) {
+    printf("Local APIC: not present.\n");
+    return;
+  }
+
+  base = rdmsr(MSR_APIC_BASE);
+  wrmsr(MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+  map_registers(base & APIC_BASE_ADDR);
+
+  /* Virtual wire mode: PIC interrupts arrive on LINT0, NMIs on
+     LINT1. */
+  lapic_write(LAPIC_LVT_LINT0, LVT_EXTINT);
+  lapic_write(LAPIC_LVT_LINT1, LVT_NMI);
+  lapic_write(LAPIC_LVT_ERROR, LVT_MASKED);
+  lapic_write(LAPIC_TPR, 0);
+  intr_register_int(LAPIC_SPURIOUS_VEC, 0, INTR_OFF, spurious_interrupt, "LAPIC spurious");
+  lapic_write(LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+  present = true;
+
+  /* Count down from the maximum for a known interval to find the
+     timer's rate. */
+  lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+  lapic_write(LAPIC_LVT_TIMER, LVT_MASKED | LAPIC_TIMER_VEC);
+  lapic_write(LAPIC_TIMER_INIT, UINT32_MAX);
+  pit_busy_wait(CALIBRATE_PIT_COUNT);
+  elapsed = UINT32_MAX - lapic_read(LAPIC_TIMER_CUR);
+  lapic_write(LAPIC_TIMER_INIT, 0);
+  timer_hz = (uint64_t)elapsed * PIT_HZ / CALIBRATE_PIT_COUNT;
+
+  /* Leave the timer in one-shot mode, unmasked but stopped. */
+  lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_VEC);
+
+  printf("Local APIC: %'" PRIu64 " kHz timer.\n", timer_hz / 1000);
+}
+
+/* Returns true if the local APIC has been enabled. */
+bool lapic_present(void) { return present; }
+
+/* Acknowledges the local APIC interrupt being handled. */
+void lapic_eoi(void) {
+  ASSERT(present);
+  lapic_write(LAPIC_EOI, 0);
+}
+
+/* Returns the local APIC ID of the running CPU. */
+uint8_t lapic_id(void) {
+  ASSERT(present);
+  return lapic_read(LAPIC_ID) >> 24;
+}
+
+/* Enables the local APIC of an application processor, the
+   registers of which appear at the same address as the boot
+   processor's, and starts its timer interrupting on TICK_VEC HZ
+   times per second.  Unlike the boot processor, an application
+   processor takes no PIC interrupts or NMIs.  lapic_init() must
+   already have run on the boot processor. */
+void lapic_init_ap(uint8_t tick_vec, unsigned hz) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(present);
+
+  wrmsr(MSR_APIC_BASE, rdmsr(MSR_APIC_BASE) | APIC_BASE_ENABLE);
+  lapic_write(LAPIC_LVT_LINT0, LVT_MASKED);
+  lapic_write(LAPIC_LVT_LINT1, LVT_MASKED);
+  lapic_write(LAPIC_LVT_ERROR, LVT_MASKED);
+  lapic_write(LAPIC_TPR, 0);
+  lapic_write(LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+
+  if (timer_hz != 0) {
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_PERIODIC | tick_vec);
+    lapic_write(LAPIC_TIMER_INIT, timer_hz / hz);
+  }
+}
+
+/* Sends the interrupt command COMMAND to the CPU whose local
+   APIC ID is APIC_ID and waits for the local APIC to accept it.
+   See [IA32-v3a] 10.6 "Issuing Interprocessor Interrupts". */
+static void send_command(uint8_t apic_id, uint32_t command) {
+  ASSERT(present);
+
+  lapic_write(LAPIC_ICR_HI, (uint32_t)apic_id << 24);
+  lapic_write(LAPIC_ICR_LO, command);
+  while (lapic_read(LAPIC_ICR_LO) & ICR_PENDING)
+    asm volatile("pause");
+}
+
+/* Sends an INIT IPI to the CPU whose local APIC ID is APIC_ID,
+   resetting it to wait for a start-up IPI: an assert followed by
+   a de-assert, as older processors require.  See [IA32-v3a] 8.4.4
+   "MP Initialization Example". */
+void lapic_send_init(uint8_t apic_id) {
+  send_command(apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+  send_command(apic_id, ICR_INIT | ICR_LEVEL);
+}
+
+/* Sends a start-up IPI to the CPU whose local APIC ID is
+   APIC_ID, which begins executing in real mode at physical
+   address PADDR, which must be page-aligned and below 1 MB. */
+void lapic_send_startup(uint8_t apic_id, uintptr_t paddr) {
+  ASSERT(paddr % PGSIZE == 0 && paddr < 0x100000);
+  send_command(apic_id, ICR_STARTUP | paddr >> 12);
+}
+
+/* Sends an interrupt on vector VEC to the CPU whose local APIC
+   ID is APIC_ID. */
+void lapic_send_ipi(uint8_t apic_id, uint8_t vec) { send_command(apic_id, ICR_FIXED | vec); }
+
+/* Returns true if lapic_timer_oneshot() may be used. */
+bool lapic_timer_available(void) { return present && timer_hz != 0; }
+
+/* Arranges for a LAPIC_TIMER_VEC interrupt approximately NS
+   nanoseconds from now, replacing any one-shot already pending.
+   Intervals too long for the 32-bit counter are clamped, so the
+   interrupt handler must be ready to find that its deadline has
+   not yet arrived. */
+void lapic_timer_oneshot(uint64_t ns) {
+  uint64_t count;
+
+  ASSERT(lapic_timer_available());
+
+  if (ns > UINT64_MAX / timer_hz)
+    count = UINT32_MAX;
+  else {
+    count = ns * timer_hz / NSEC_PER_SEC;
+    if (count > UINT32_MAX)
+      count = UINT32_MAX;
+    else if (count == 0)
+      count = 1;
+  }
+  lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+/* Cancels any pending one-shot timer interrupt. */
+void lapic_timer_cancel(void) {
+  if (lapic_timer_available())
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
+
+/* Spurious interrupts need no acknowledgement.  See [IA32-v3a]
+   10.9 "Spurious Interrupt". */
+static void spurious_interrupt(struct intr_frame* f UNUSED) {}
@@ -0,0 +1,29 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vectors used by the local APIC.  Device interrupts
+   from the local APIC are external interrupts, like those from
+   the PICs, but occupy vectors 0xf0...0xfe. */
+#define LAPIC_TIMER_VEC 0xf0    /* Local APIC timer. */
+#define LAPIC_SPURIOUS_VEC 0xff /* Spurious interrupts. */
+
+void lapic_init(void);
+bool lapic_present(void);
+void lapic_eoi(void);
+uint8_t lapic_id(void);
+
+/* Multiprocessor support. */
+void lapic_init_ap(uint8_t tick_vec, unsigned hz);
+void lapic_send_init(uint8_t apic_id);
+void lapic_send_startup(uint8_t apic_id, uintptr_t paddr);
+void lapic_send_ipi(uint8_t apic_id, uint8_t vec);
+
+/* One-shot timer. */
+bool lapic_timer_available(void);
+void lapic_timer_oneshot(uint64_t ns);
+void lapic_timer_cancel(void);
+
+#endif /* devices/lapic.h */
@@ -10,9 +10,11 @@
 /* 8254 registers. */
 #define PIT_PORT_CONTROL 0x43                        /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL)) /* Counter port. */
+#define PIT_PORT_GATE 0x61                           /* Channel 2 gate and speaker. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
+/* Bits in PIT_PORT_GATE. */
+#define PIT_GATE_CHANNEL2 0x01 /* Channel 2 gate input. */
+#define PIT_GATE_SPEAKER 0x02  /* Connects channel 2 output to speaker. */
 
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
@@ -75,3 +77,82 @@ void pit_configure_channel(int channel, int mode, int frequency) {
   outb(PIT_PORT_COUNTER(channel), count >> 8);
   intr_set_level(old_level);
 }
+
+/* Starts CHANNEL counting down from COUNT PIT cycles in mode 0,
+   "interrupt on terminal count": the channel's output goes low
+   and rises once, after COUNT cycles, so a channel 0 interrupt
+   fires exactly once.  A COUNT of 0 is treated as 65536. */
+void pit_start_oneshot(int channel, uint16_t count) {
+  enum intr_level old_level;
+
+  ASSERT(channel == 0 || channel == 2);
+
+  old_level = intr_disable();
+  outb(PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb(PIT_PORT_COUNTER(channel), count);
+  outb(PIT_PORT_COUNTER(channel), count >> 8);
+  intr_set_level(old_level);
+}
+
+/* Returns the current value of CHANNEL's counter, that is, the
+   number of PIT cycles left before it reaches terminal count, and
+   stores in *OUTPUT_HIGH whether the channel's output is high,
+   as pit_output_high() would.  Both are latched at the same
+   instant, so a channel started with pit_start_oneshot() either
+   has reached terminal count or has the returned count left. */
+uint16_t pit_read_count(int channel, bool* output_high) {
+  enum intr_level old_level;
+  uint8_t status;
+  uint16_t count;
+
+  ASSERT(channel == 0 || channel == 2);
+
+  /* Read-back command: latch both the status and the count of
+     the selected channel, then read the status, followed by the
+     count low byte first. */
+  old_level = intr_disable();
+  outb(PIT_PORT_CONTROL, 0xc0 | (0x02 << channel));
+  status = inb(PIT_PORT_COUNTER(channel));
+  count = inb(PIT_PORT_COUNTER(channel));
+  count |= inb(PIT_PORT_COUNTER(channel)) << 8;
+  intr_set_level(old_level);
+  *output_high = (status & 0x80) != 0;
+  return count;
+}
+
+/* Returns true if CHANNEL's output is currently high, which for a
+   channel started with pit_start_oneshot() means that it has
+   reached terminal count. */
+bool pit_output_high(int channel) {
+  enum intr_level old_level;
+  uint8_t status;
+
+  ASSERT(channel == 0 || channel == 2);
+
+  /* Read-back command: latch the status, but not the count, of
+     the selected channel.  Bit 7 of the status is the output. */
+  old_level = intr_disable();
+  outb(PIT_PORT_CONTROL, 0xe0 | (0x02 << channel));
+  status = inb(PIT_PORT_COUNTER(channel));
+  intr_set_level(old_level);
+  return (status & 0x80) != 0;
+}
+
+/* Busy-waits for COUNT PIT cycles, using channel 2 as a one-shot
+   stopwatch.  Does not depend on interrupts, so it may be used to
+   calibrate other clocks before interrupts are enabled.  Channel
+   2 is shared with the PC speaker, whose output is disconnected
+   while we wait. */
+void pit_busy_wait(uint16_t count) {
+  enum intr_level old_level = intr_disable();
+  uint8_t gate = inb(PIT_PORT_GATE);
+
+  /* Raise channel 2's gate input so that it counts, but keep the
+     speaker disconnected. */
+  outb(PIT_PORT_GATE, (gate & ~PIT_GATE_SPEAKER) | PIT_GATE_CHANNEL2);
+  pit_start_oneshot(2, count);
+  while (!pit_output_high(2))
+    continue;
+  outb(PIT_PORT_GATE, gate);
+  intr_set_level(old_level);
+}
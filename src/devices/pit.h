@@ -1,8 +1,16 @@
 #ifndef DEVICES_PIT_H
 #define DEVICES_PIT_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+
 void pit_configure_channel(int channel, int mode, int frequency);
+void pit_start_oneshot(int channel, uint16_t count);
+uint16_t pit_read_count(int channel, bool* output_high);
+bool pit_output_high(int channel);
+void pit_busy_wait(uint16_t count);
 
 #endif /* devices/pit.h */
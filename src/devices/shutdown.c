@@ -4,9 +4,15 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/defer.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/lockstat.h"
+#include "threads/sched-trace.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
+#include "userprog/cpu-group.h"
 #include "userprog/exception.h"
 #endif
 #ifdef FILESYS
@@ -82,6 +88,7 @@ void shutdown_power_off(void) {
 #endif
 
   print_stats();
+  sched_trace_dump();
 
   printf("Powering off...\n");
   serial_flush();
@@ -116,6 +123,11 @@ void shutdown_power_off(void) {
 static void print_stats(void) {
   timer_print_stats();
   thread_print_stats();
+  lockstat_print_stats();
+  intr_print_stats();
+  defer_print_stats();
+  lock_print_stats();
+  rcu_print_stats();
 #ifdef FILESYS
   block_print_stats();
 #endif
@@ -123,5 +135,6 @@ static void print_stats(void) {
   kbd_print_stats();
 #ifdef USERPROG
   exception_print_stats();
+  cpu_group_print_stats();
 #endif
 }
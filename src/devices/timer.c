@@ -1,10 +1,15 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/clock.h"
+#include "devices/lapic.h"
 #include "devices/pit.h"
+#include "threads/defer.h"
 #include "threads/interrupt.h"
+#include "threads/smp.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -17,33 +22,135 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.  Written only by the
+   timer interrupt, inside TICKS_SEQ, so that timer_ticks() can
+   read it without the kernel lock. */
 static int64_t ticks;
+static struct seqlock ticks_seq;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
+/* Number of loops per timer tick, used for brief delays only
+   when there is no TSC.  Initialized by timer_calibrate(), unless
+   preset with timer_set_loops_per_tick(). */
 static unsigned loops_per_tick;
 
+/* Sleep queue: a timer wheel of threads blocked in timer_sleep().
+   A thread that wakes at tick T sits in bucket T % SLEEP_WHEEL_SIZE,
+   and each bucket is kept sorted by wake-up tick, so the timer
+   interrupt only looks at the head of a single bucket per tick
+   and touches nothing but the threads that are due.
+
+   The timer interrupt does not wake the threads itself.  It
+   defers wake_work to the interrupt's return, which wakes one
+   thread at a time with interrupts off, so that a burst of
+   simultaneous wake-ups does not hold interrupts off throughout.
+   The work catches up tick by tick to the current tick, so it
+   does not matter how many ticks pass before it runs. */
+#define SLEEP_WHEEL_SIZE 64 /* Must be a power of 2. */
+static struct list sleep_wheel[SLEEP_WHEEL_SIZE];
+static struct deferred_work wake_work;
+static int64_t woken_through; /* Last tick whose sleepers were all woken. */
+
+/* Tickless idle.  When the idle thread is about to halt and no
+   sleeper is due within the next tick, timer_idle_enter() stops
+   the periodic interrupt and arms a one-shot PIT countdown for
+   the next sleep deadline instead.  The one-shot interrupt then
+   catches `ticks' up by the number of ticks skipped and restores
+   the periodic interrupt.  Channel 0's 16-bit counter limits a
+   one-shot to TICKLESS_MAX_TICKS ticks, about 55 ms. */
+#define PIT_COUNTS_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define TICKLESS_MAX_TICKS (UINT16_MAX / PIT_COUNTS_PER_TICK)
+
+/* If true, the idle thread runs tickless.  Controlled by the
+   kernel command-line option "-timer=tickless". */
+bool timer_tickless;
+
+/* High-resolution sleep queue: threads blocked until a clock_ns()
+   deadline that does not fall on a timer tick, sorted by
+   deadline.  The local APIC timer is armed for the first
+   deadline. */
+static struct list hires_sleepers;
+
+static int tickless_ticks;      /* Ticks the armed one-shot covers, or 0. */
+static uint16_t tickless_count; /* PIT cycles the one-shot was armed for. */
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops(unsigned loops);
+static void calibrate_by_search(void);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
+static list_less_func wake_tick_less;
+static list_less_func wake_ns_less;
+static intr_handler_func hires_interrupt;
+static void hires_sleep_until(uint64_t deadline);
+static defer_func wake_sleepers;
+static struct thread* next_due_sleeper(void);
+static void timer_tick(bool user);
+static int64_t next_wake_tick(void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void timer_init(void) {
+  size_t i;
+
+  for (i = 0; i < SLEEP_WHEEL_SIZE; i++)
+    list_init(&sleep_wheel[i]);
+  deferred_work_init(&wake_work, wake_sleepers, NULL);
+  seqlock_init(&ticks_seq);
+
+  list_init(&hires_sleepers);
+
   pit_configure_channel(0, 2, TIMER_FREQ);
   intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Starts the high-resolution clock and, if there is a local APIC,
+   registers its timer interrupt for high-resolution sleeps.  Must
+   be called after timer_init(), with interrupts off. */
+void timer_init_hires(void) {
+  clock_init();
+  lapic_init();
+  if (lapic_timer_available())
+    intr_register_ext(LAPIC_TIMER_VEC, hires_interrupt, "LAPIC Timer");
+}
+
+/* Sets loops_per_tick to LOOPS, so that timer_calibrate() can
+   skip calibration.  Used for the "-lpt=N" kernel command-line
+   option, typically with the value a previous boot reported. */
+void timer_set_loops_per_tick(unsigned loops) { loops_per_tick = loops; }
+
+/* Calibrates loops_per_tick, used to implement brief delays.
+
+   A value preset with timer_set_loops_per_tick() is used as is.
+   Otherwise, if there is a TSC, brief delays are timed with it
+   and loops_per_tick is not needed, so calibration is skipped.
+   Only without a TSC do we search for the number of loops that
+   fits in a tick, which takes several hundred milliseconds. */
 void timer_calibrate(void) {
-  unsigned high_bit, test_bit;
+  const char* source;
 
   ASSERT(intr_get_level() == INTR_ON);
   printf("Calibrating timer...  ");
 
+  if (loops_per_tick != 0)
+    source = "preset";
+  else if (clock_has_tsc()) {
+    printf("skipped, delays use the TSC.\n");
+    return;
+  } else {
+    calibrate_by_search();
+    source = "measured";
+  }
+
+  printf("%'" PRIu64 " loops/s (%s, -lpt=%u).\n", (uint64_t)loops_per_tick * TIMER_FREQ, source,
+         loops_per_tick);
+}
+
+/* Calibrates loops_per_tick by binary search, timing runs of the
+   busy loop against timer ticks. */
+static void calibrate_by_search(void) {
+  unsigned high_bit, test_bit;
+
   /* Approximate loops_per_tick as the largest power-of-two
      still less than one timer tick. */
   loops_per_tick = 1u << 10;
@@ -57,15 +164,17 @@ void timer_calibrate(void) {
   for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
     if (!too_many_loops(loops_per_tick | test_bit))
       loops_per_tick |= test_bit;
-
-  printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t timer_ticks(void) {
-  enum intr_level old_level = intr_disable();
-  int64_t t = ticks;
-  intr_set_level(old_level);
+  unsigned seq;
+  int64_t t;
+
+  do {
+    seq = seqlock_read_begin(&ticks_seq);
+    t = ticks;
+  } while (seqlock_read_retry(&ticks_seq, seq));
   return t;
 }
 
@@ -74,13 +183,37 @@ int64_t timer_ticks(void) {
 int64_t timer_elapsed(int64_t then) { return timer_ticks() - then; }
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The calling thread blocks on the sleep queue until the timer
+   interrupt for its wake-up tick unblocks it, so sleeping
+   threads cost nothing while they wait. */
 void timer_sleep(int64_t ticks) {
-  int64_t start = timer_ticks();
+  ASSERT(intr_get_level() == INTR_ON);
+  if (ticks <= 0)
+    return;
+
+  timer_sleep_until(timer_ticks() + ticks);
+}
+
+/* Sleeps until the timer tick count reaches WAKE_TICK, returning
+   immediately if it already has.  Interrupts must be turned on.
+   Unlike timer_sleep(), the wake-up tick does not drift if the
+   caller is preempted before it gets here. */
+void timer_sleep_until(int64_t wake_tick) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
 
   ASSERT(intr_get_level() == INTR_ON);
-  while (timer_elapsed(start) < ticks)
-    thread_yield();
+
+  old_level = intr_disable();
+  if (wake_tick > ticks) {
+    cur->wake_tick = wake_tick;
+    list_insert_ordered(&sleep_wheel[wake_tick & (SLEEP_WHEEL_SIZE - 1)], &cur->elem,
+                        wake_tick_less, NULL);
+    thread_block();
+  }
+  intr_set_level(old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -88,11 +221,16 @@ void timer_sleep(int64_t ticks) {
 void timer_msleep(int64_t ms) { real_time_sleep(ms, 1000); }
 
 /* Sleeps for approximately US microseconds.  Interrupts must be
-   turned on. */
+   turned on.
+
+   With a TSC clock, the sleep ends at the exact deadline rather
+   than on a timer tick, and if there is also a local APIC timer
+   the calling thread blocks for the sub-tick remainder instead
+   of busy-waiting. */
 void timer_usleep(int64_t us) { real_time_sleep(us, 1000 * 1000); }
 
 /* Sleeps for approximately NS nanoseconds.  Interrupts must be
-   turned on. */
+   turned on.  See timer_usleep() for precision. */
 void timer_nsleep(int64_t ns) { real_time_sleep(ns, 1000 * 1000 * 1000); }
 
 /* Busy-waits for approximately MS milliseconds.  Interrupts need
@@ -125,10 +263,161 @@ void timer_ndelay(int64_t ns) { real_time_delay(ns, 1000 * 1000 * 1000); }
 /* Prints timer statistics. */
 void timer_print_stats(void) { printf("Timer: %" PRId64 " ticks\n", timer_ticks()); }
 
+/* Called by the idle thread with interrupts off just before it
+   halts.  In tickless mode, if no thread is due to wake up within
+   the next tick, replaces the periodic timer interrupt with a
+   one-shot interrupt at the next wake-up deadline or real-time
+   budget replenishment, whichever comes first. */
+void timer_idle_enter(void) {
+  int64_t wake_tick, idle_ticks;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (!timer_tickless || tickless_ticks != 0)
+    return;
+
+  wake_tick = next_wake_tick();
+  if (thread_rt_next_release() < wake_tick)
+    wake_tick = thread_rt_next_release();
+  idle_ticks = wake_tick - ticks;
+  if (idle_ticks > TICKLESS_MAX_TICKS)
+    idle_ticks = TICKLESS_MAX_TICKS;
+  if (idle_ticks < 2)
+    return;
+
+  tickless_ticks = idle_ticks;
+  tickless_count = idle_ticks * PIT_COUNTS_PER_TICK;
+  pit_start_oneshot(0, tickless_count);
+}
+
+/* Called by the idle thread with interrupts off when it resumes
+   after halting.  If an interrupt other than the timer woke it up
+   before the one-shot deadline, re-arms the one-shot to fire at
+   the next tick boundary instead, so that a thread made ready by
+   that interrupt does not wait for the rest of the idle period
+   for its next timer tick.  The skipped ticks are accounted for
+   when the one-shot fires, less than a tick from now.
+
+   The count and the output are latched together, so the one-shot
+   cannot expire unseen between checking for expiry and reading
+   how far it got.  It is re-armed only if more than a tick is
+   left on it, which is far longer than re-arming takes, so it
+   cannot expire while being re-armed either: a one-shot whose
+   interrupt is pending is never re-armed, and a tick is neither
+   lost nor counted twice. */
+void timer_idle_exit(void) {
+  uint16_t count, elapsed;
+  bool expired;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (tickless_ticks == 0)
+    return;
+
+  count = pit_read_count(0, &expired);
+  if (expired || count <= PIT_COUNTS_PER_TICK)
+    return;
+
+  elapsed = tickless_count - count;
+  tickless_ticks = elapsed / PIT_COUNTS_PER_TICK + 1;
+  tickless_count = PIT_COUNTS_PER_TICK - elapsed % PIT_COUNTS_PER_TICK;
+  pit_start_oneshot(0, tickless_count);
+}
+
 /* Timer interrupt handler. */
-static void timer_interrupt(struct intr_frame* args UNUSED) {
+static void timer_interrupt(struct intr_frame* args) {
+  if (tickless_ticks != 0) {
+    /* A tickless one-shot expired.  Go back to periodic
+       interrupts and run the ticks that were skipped. */
+    int skipped = tickless_ticks;
+
+    tickless_ticks = 0;
+    pit_configure_channel(0, 2, TIMER_FREQ);
+    while (--skipped > 0)
+      timer_tick(false);
+  }
+
+  /* The low bits of the interrupted code segment selector give
+     the privilege level it was running at. */
+  timer_tick((args->cs & 3) == 3);
+}
+
+/* Advances the tick count by one and does the per-tick work.
+   USER is true if the tick interrupted user code. */
+static void timer_tick(bool user) {
+  seqlock_write_begin(&ticks_seq);
   ticks++;
-  thread_tick();
+  seqlock_write_end(&ticks_seq);
+  defer_on_return(&wake_work);
+  thread_tick(user);
+}
+
+/* Returns the earliest tick at which a sleeping thread wakes up,
+   or INT64_MAX if no thread is sleeping.  Each bucket is sorted,
+   so only the bucket heads need to be examined. */
+static int64_t next_wake_tick(void) {
+  int64_t wake_tick = INT64_MAX;
+  size_t i;
+
+  for (i = 0; i < SLEEP_WHEEL_SIZE; i++)
+    if (!list_empty(&sleep_wheel[i])) {
+      struct thread* t = list_entry(list_front(&sleep_wheel[i]), struct thread, elem);
+      if (t->wake_tick < wake_tick)
+        wake_tick = t->wake_tick;
+    }
+  return wake_tick;
+}
+
+/* Returns true if sleeping thread A wakes up before sleeping
+   thread B. */
+static bool wake_tick_less(const struct list_elem* a_, const struct list_elem* b_,
+                           void* aux UNUSED) {
+  const struct thread* a = list_entry(a_, struct thread, elem);
+  const struct thread* b = list_entry(b_, struct thread, elem);
+
+  return a->wake_tick < b->wake_tick;
+}
+
+/* Unblocks every sleeping thread whose wake-up tick has arrived,
+   turning interrupts off for one thread at a time.  Deferred work
+   run by the timer interrupt. */
+static void wake_sleepers(void* aux UNUSED) {
+  for (;;) {
+    enum intr_level old_level = intr_disable();
+    struct thread* t = next_due_sleeper();
+
+    if (t != NULL)
+      thread_unblock(t);
+    intr_set_level(old_level);
+    if (t == NULL)
+      break;
+  }
+  thread_check_preemption();
+}
+
+/* Removes and returns the next sleeping thread whose wake-up tick
+   has arrived, or returns a null pointer if there is none.  Only
+   tick T's bucket can hold threads due at tick T, and since the
+   bucket is sorted we can stop at the first one that is still a
+   full wheel revolution (or more) away.  Must be called with
+   interrupts off. */
+static struct thread* next_due_sleeper(void) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  while (woken_through < ticks) {
+    int64_t tick = woken_through + 1;
+    struct list* bucket = &sleep_wheel[tick & (SLEEP_WHEEL_SIZE - 1)];
+
+    if (!list_empty(bucket)) {
+      struct thread* t = list_entry(list_front(bucket), struct thread, elem);
+      if (t->wake_tick <= tick) {
+        list_pop_front(bucket);
+        return t;
+      }
+    }
+    woken_through = tick;
+  }
+  return NULL;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -171,7 +460,18 @@ static void real_time_sleep(int64_t num, int32_t denom) {
   int64_t ticks = num * TIMER_FREQ / denom;
 
   ASSERT(intr_get_level() == INTR_ON);
-  if (ticks > 0) {
+  if (clock_has_tsc()) {
+    /* Sleep through whole ticks on the sleep queue, which is
+       cheaper, then wait out the rest against the TSC clock. */
+    uint64_t deadline;
+
+    if (num <= 0)
+      return;
+    deadline = clock_ns() + num * (NSEC_PER_SEC / denom);
+    if (ticks > 1)
+      timer_sleep(ticks - 1);
+    hires_sleep_until(deadline);
+  } else if (ticks > 0) {
     /* We're waiting for at least one full timer tick.  Use
          timer_sleep() because it will yield the CPU to other
          processes. */
@@ -188,5 +488,64 @@ static void real_time_delay(int64_t num, int32_t denom) {
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT(denom % 1000 == 0);
-  busy_wait(loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+  if (clock_has_tsc()) {
+    if (num > 0)
+      clock_ndelay(num * (NSEC_PER_SEC / denom));
+  } else
+    busy_wait(loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+}
+
+/* Waits until clock_ns() reaches DEADLINE.  Blocks on the local
+   APIC timer if there is one, and otherwise busy-waits.  Only
+   the boot processor's local APIC timer runs in one-shot mode,
+   so other CPUs busy-wait too. */
+static void hires_sleep_until(uint64_t deadline) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+  uint64_t now;
+
+  old_level = intr_disable();
+  if (!lapic_timer_available() || cpu_current()->id != 0) {
+    intr_set_level(old_level);
+    while (clock_ns() < deadline)
+      continue;
+    return;
+  }
+
+  now = clock_ns();
+  if (now < deadline) {
+    cur->wake_ns = deadline;
+    list_insert_ordered(&hires_sleepers, &cur->elem, wake_ns_less, NULL);
+    if (list_front(&hires_sleepers) == &cur->elem)
+      lapic_timer_oneshot(deadline - now);
+    thread_block();
+  }
+  intr_set_level(old_level);
+}
+
+/* Returns true if high-resolution sleeper A wakes up before B. */
+static bool wake_ns_less(const struct list_elem* a_, const struct list_elem* b_,
+                         void* aux UNUSED) {
+  const struct thread* a = list_entry(a_, struct thread, elem);
+  const struct thread* b = list_entry(b_, struct thread, elem);
+
+  return a->wake_ns < b->wake_ns;
+}
+
+/* Local APIC timer interrupt handler.  Wakes every
+   high-resolution sleeper whose deadline has passed and re-arms
+   the timer for the next one. */
+static void hires_interrupt(struct intr_frame* args UNUSED) {
+  uint64_t now = clock_ns();
+
+  while (!list_empty(&hires_sleepers)) {
+    struct thread* t = list_entry(list_front(&hires_sleepers), struct thread, elem);
+    if (t->wake_ns > now) {
+      lapic_timer_oneshot(t->wake_ns - now);
+      break;
+    }
+    list_pop_front(&hires_sleepers);
+    thread_unblock(t);
+  }
+  thread_check_preemption();
 }
@@ -2,19 +2,27 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Run the idle thread without periodic timer interrupts?
+   Controlled by the kernel command-line option "-timer". */
+extern bool timer_tickless;
+
 void timer_init(void);
+void timer_init_hires(void);
 void timer_calibrate(void);
+void timer_set_loops_per_tick(unsigned loops);
 
 int64_t timer_ticks(void);
 int64_t timer_elapsed(int64_t);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep(int64_t ticks);
+void timer_sleep_until(int64_t wake_tick);
 void timer_msleep(int64_t milliseconds);
 void timer_usleep(int64_t microseconds);
 void timer_nsleep(int64_t nanoseconds);
@@ -24,6 +32,10 @@ void timer_mdelay(int64_t milliseconds);
 void timer_udelay(int64_t microseconds);
 void timer_ndelay(int64_t nanoseconds);
 
+/* Tickless idle. */
+void timer_idle_enter(void);
+void timer_idle_exit(void);
+
 void timer_print_stats(void);
 
 #endif /* devices/timer.h */
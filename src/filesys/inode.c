@@ -1,4 +1,5 @@
 #include "filesys/inode.h"
+#include <atomic.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
@@ -6,6 +7,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -26,8 +28,9 @@ static inline size_t bytes_to_sectors(off_t size) { return DIV_ROUND_UP(size, BL
 /* In-memory inode. */
 struct inode {
   struct list_elem elem;  /* Element in inode list. */
+  struct rcu_head rcu;    /* Frees the inode after it leaves the list. */
   block_sector_t sector;  /* Sector number of disk location. */
-  int open_cnt;           /* Number of openers. */
+  int open_cnt;           /* Number of openers, updated atomically. */
   bool removed;           /* True if deleted, false otherwise. */
   int deny_write_cnt;     /* 0: writes ok, >0: deny writes. */
   struct inode_disk data; /* Inode content. */
@@ -46,11 +49,60 @@ static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
 }
 
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.
+
+   Lookups read the list under RCU, with interrupts on and without
+   a lock, so they do not take the kernel lock either and may run
+   in parallel.  Reading from disk still serializes on the disk
+   controller's lock.  Adding and removing inodes takes
+   open_inodes_lock, and an inode removed from the list is freed
+   only after an RCU grace period.  An inode whose open_cnt has
+   dropped to 0 is on its way out and cannot be reopened. */
 static struct list open_inodes;
+static struct lock open_inodes_lock;
 
 /* Initializes the inode module. */
-void inode_init(void) { list_init(&open_inodes); }
+void inode_init(void) {
+  list_init(&open_inodes);
+  lock_init(&open_inodes_lock);
+}
+
+/* Atomically increments *CNT unless it is 0.  Returns true if
+   successful, false if *CNT was 0. */
+static bool inc_not_zero(volatile int* cnt) {
+  int old = *cnt;
+
+  while (old != 0) {
+    int seen = atomic_cmpxchg(cnt, old, old + 1);
+    if (seen == old)
+      return true;
+    old = seen;
+  }
+  return false;
+}
+
+/* Returns the open inode for SECTOR, with a new reference, or a
+   null pointer if none is open. */
+static struct inode* inode_lookup(block_sector_t sector) {
+  struct inode* found = NULL;
+  struct list_elem* e;
+
+  rcu_read_lock();
+  for (e = list_begin(&open_inodes); e != list_end(&open_inodes); e = list_next(e)) {
+    struct inode* inode = list_entry(e, struct inode, elem);
+    if (inode->sector == sector && inc_not_zero(&inode->open_cnt)) {
+      found = inode;
+      break;
+    }
+  }
+  rcu_read_unlock();
+  return found;
+}
+
+/* Frees the inode whose rcu member is HEAD. */
+static void inode_free(struct rcu_head* head) {
+  free(list_entry(&head->elem, struct inode, rcu.elem));
+}
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
@@ -92,37 +144,43 @@ bool inode_create(block_sector_t sector, off_t length) {
    and returns a `struct inode' that contains it.
    Returns a null pointer if memory allocation fails. */
 struct inode* inode_open(block_sector_t sector) {
-  struct list_elem* e;
   struct inode* inode;
+  struct inode* other;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin(&open_inodes); e != list_end(&open_inodes); e = list_next(e)) {
-    inode = list_entry(e, struct inode, elem);
-    if (inode->sector == sector) {
-      inode_reopen(inode);
-      return inode;
-    }
-  }
+  inode = inode_lookup(sector);
+  if (inode != NULL)
+    return inode;
 
   /* Allocate memory. */
   inode = malloc(sizeof *inode);
   if (inode == NULL)
     return NULL;
 
-  /* Initialize. */
-  list_push_front(&open_inodes, &inode->elem);
+  /* Initialize, before lookups can find it. */
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
   block_read(fs_device, inode->sector, &inode->data);
+
+  /* Add it, unless another thread opened the inode meanwhile. */
+  lock_acquire(&open_inodes_lock);
+  other = inode_lookup(sector);
+  if (other == NULL)
+    rcu_list_push_front(&open_inodes, &inode->elem);
+  lock_release(&open_inodes_lock);
+  if (other != NULL) {
+    free(inode);
+    return other;
+  }
   return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode* inode_reopen(struct inode* inode) {
   if (inode != NULL)
-    inode->open_cnt++;
+    atomic_fetch_add(&inode->open_cnt, 1);
   return inode;
 }
 
@@ -138,9 +196,11 @@ void inode_close(struct inode* inode) {
     return;
 
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0) {
-    /* Remove from inode list and release lock. */
+  if (atomic_fetch_add(&inode->open_cnt, -1) == 1) {
+    /* Remove from inode list. */
+    lock_acquire(&open_inodes_lock);
     list_remove(&inode->elem);
+    lock_release(&open_inodes_lock);
 
     /* Deallocate blocks if removed. */
     if (inode->removed) {
@@ -148,7 +208,8 @@ void inode_close(struct inode* inode) {
       free_map_release(inode->data.start, bytes_to_sectors(inode->data.length));
     }
 
-    free(inode);
+    /* Lookups may still be looking at it. */
+    call_rcu(&inode->rcu, inode_free);
   }
 }
 
@@ -0,0 +1,34 @@
+#ifndef __LIB_ATOMIC_H
+#define __LIB_ATOMIC_H
+
+/* Atomic operations on an int shared between CPUs, or between
+   threads that take no lock to update it.  Usable from both the
+   kernel and user programs.
+
+   Each operation is a single locked instruction, which on x86 is
+   also a full memory barrier, and each tells the compiler that
+   memory may have changed, so neither loads nor stores move
+   across it.  See [IA32-v3a] 8.1.2 "Bus Locking" and 8.2.2
+   "Memory Ordering in P6 and More Recent Processor Families". */
+
+/* Atomically adds INC to *P and returns the value *P had. */
+static inline int atomic_fetch_add(volatile int* p, int inc) {
+  asm volatile("lock xaddl %0, %1" : "+r"(inc), "+m"(*p) : : "memory");
+  return inc;
+}
+
+/* Atomically sets *P to NEW and returns the value *P had.  The
+   `xchg' instruction is locked even without a `lock' prefix. */
+static inline int atomic_xchg(volatile int* p, int new) {
+  asm volatile("xchgl %0, %1" : "+r"(new), "+m"(*p) : : "memory");
+  return new;
+}
+
+/* Atomically sets *P to NEW if it equals OLD, and returns the
+   value *P had, which equals OLD if and only if *P was set. */
+static inline int atomic_cmpxchg(volatile int* p, int old, int new) {
+  asm volatile("lock cmpxchgl %2, %1" : "+a"(old), "+m"(*p) : "r"(new) : "memory");
+  return old;
+}
+
+#endif /* lib/atomic.h */
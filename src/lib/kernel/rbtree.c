@@ -0,0 +1,282 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  The algorithms follow
+   [CLRS] chapter 13, using null pointers in place of the
+   sentinel leaf. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static bool is_red(const struct rb_elem*);
+static void replace_child(struct rbtree*, struct rb_elem* old, struct rb_elem* new);
+static void rotate_left(struct rbtree*, struct rb_elem*);
+static void rotate_right(struct rbtree*, struct rb_elem*);
+static void insert_fixup(struct rbtree*, struct rb_elem*);
+static void remove_fixup(struct rbtree*, struct rb_elem*, struct rb_elem* parent);
+
+/* Initializes T as an empty tree that orders its elements using
+   LESS, given auxiliary data AUX. */
+void rb_init(struct rbtree* t, rb_less_func* less, void* aux) {
+  ASSERT(t != NULL);
+  ASSERT(less != NULL);
+
+  t->root = NULL;
+  t->elem_cnt = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Inserts E into T.  E is placed after any elements that compare
+   equal to it. */
+void rb_insert(struct rbtree* t, struct rb_elem* e) {
+  struct rb_elem* parent = NULL;
+  struct rb_elem** link = &t->root;
+
+  ASSERT(e != NULL);
+
+  while (*link != NULL) {
+    parent = *link;
+    link = t->less(e, parent, t->aux) ? &parent->left : &parent->right;
+  }
+
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+
+  insert_fixup(t, e);
+  t->elem_cnt++;
+}
+
+/* Removes E, which must be an element of T, from T. */
+void rb_remove(struct rbtree* t, struct rb_elem* e) {
+  struct rb_elem *child, *parent;
+  bool removed_red;
+
+  ASSERT(e != NULL);
+  ASSERT(t->elem_cnt > 0);
+
+  if (e->left == NULL || e->right == NULL) {
+    /* E has at most one child, which takes E's place. */
+    child = e->left != NULL ? e->left : e->right;
+    parent = e->parent;
+    removed_red = e->red;
+    if (child != NULL)
+      child->parent = parent;
+    replace_child(t, e, child);
+  } else {
+    /* E's successor Y, which has no left child, takes E's
+       place, and Y's right child takes Y's place. */
+    struct rb_elem* y = e->right;
+    while (y->left != NULL)
+      y = y->left;
+
+    child = y->right;
+    removed_red = y->red;
+    if (y->parent == e)
+      parent = y;
+    else {
+      parent = y->parent;
+      parent->left = child;
+      if (child != NULL)
+        child->parent = parent;
+      y->right = e->right;
+      y->right->parent = y;
+    }
+    y->left = e->left;
+    y->left->parent = y;
+    y->parent = e->parent;
+    replace_child(t, e, y);
+    y->red = e->red;
+  }
+
+  if (!removed_red)
+    remove_fixup(t, child, parent);
+  t->elem_cnt--;
+}
+
+/* Returns the least element in T, or a null pointer if T is
+   empty.  Among equal elements, returns the one inserted
+   first. */
+struct rb_elem* rb_min(const struct rbtree* t) {
+  struct rb_elem* e = t->root;
+
+  if (e != NULL)
+    while (e->left != NULL)
+      e = e->left;
+  return e;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the greatest element. */
+struct rb_elem* rb_next(const struct rb_elem* e) {
+  ASSERT(e != NULL);
+
+  if (e->right != NULL) {
+    e = e->right;
+    while (e->left != NULL)
+      e = e->left;
+    return (struct rb_elem*)e;
+  }
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t rb_size(const struct rbtree* t) { return t->elem_cnt; }
+
+/* Returns true if T contains no elements, false otherwise. */
+bool rb_empty(const struct rbtree* t) { return t->root == NULL; }
+
+/* Returns true if E is a red node.  Null leaves are black. */
+static bool is_red(const struct rb_elem* e) { return e != NULL && e->red; }
+
+/* Makes NEW take OLD's place as a child of OLD's parent, or as
+   the root of T if OLD has no parent. */
+static void replace_child(struct rbtree* t, struct rb_elem* old, struct rb_elem* new) {
+  struct rb_elem* parent = old->parent;
+
+  if (parent == NULL)
+    t->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
+
+/* Rotates X down to the left, making its right child its
+   parent. */
+static void rotate_left(struct rbtree* t, struct rb_elem* x) {
+  struct rb_elem* y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  y->parent = x->parent;
+  replace_child(t, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Rotates X down to the right, making its left child its
+   parent. */
+static void rotate_right(struct rbtree* t, struct rb_elem* x) {
+  struct rb_elem* y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  y->parent = x->parent;
+  replace_child(t, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Restores the red-black properties after red node E has been
+   inserted into T. */
+static void insert_fixup(struct rbtree* t, struct rb_elem* e) {
+  struct rb_elem* parent;
+
+  while (is_red(parent = e->parent)) {
+    /* PARENT is red, so it is not the root. */
+    struct rb_elem* grandparent = parent->parent;
+
+    if (parent == grandparent->left) {
+      struct rb_elem* uncle = grandparent->right;
+      if (is_red(uncle)) {
+        parent->red = uncle->red = false;
+        grandparent->red = true;
+        e = grandparent;
+      } else {
+        if (e == parent->right) {
+          rotate_left(t, parent);
+          e = parent;
+          parent = e->parent;
+        }
+        parent->red = false;
+        grandparent->red = true;
+        rotate_right(t, grandparent);
+      }
+    } else {
+      struct rb_elem* uncle = grandparent->left;
+      if (is_red(uncle)) {
+        parent->red = uncle->red = false;
+        grandparent->red = true;
+        e = grandparent;
+      } else {
+        if (e == parent->left) {
+          rotate_right(t, parent);
+          e = parent;
+          parent = e->parent;
+        }
+        parent->red = false;
+        grandparent->red = true;
+        rotate_left(t, grandparent);
+      }
+    }
+  }
+  t->root->red = false;
+}
+
+/* Restores the red-black properties after a black node has been
+   removed from T.  E is the (possibly null) node that took its
+   place and PARENT is E's parent. */
+static void remove_fixup(struct rbtree* t, struct rb_elem* e, struct rb_elem* parent) {
+  while (e != t->root && !is_red(e)) {
+    /* E is "doubly black", so its sibling cannot be null. */
+    if (e == parent->left) {
+      struct rb_elem* sibling = parent->right;
+      if (sibling->red) {
+        sibling->red = false;
+        parent->red = true;
+        rotate_left(t, parent);
+        sibling = parent->right;
+      }
+      if (!is_red(sibling->left) && !is_red(sibling->right)) {
+        sibling->red = true;
+        e = parent;
+        parent = e->parent;
+      } else {
+        if (!is_red(sibling->right)) {
+          sibling->left->red = false;
+          sibling->red = true;
+          rotate_right(t, sibling);
+          sibling = parent->right;
+        }
+        sibling->red = parent->red;
+        parent->red = false;
+        sibling->right->red = false;
+        rotate_left(t, parent);
+        e = t->root;
+      }
+    } else {
+      struct rb_elem* sibling = parent->left;
+      if (sibling->red) {
+        sibling->red = false;
+        parent->red = true;
+        rotate_right(t, parent);
+        sibling = parent->left;
+      }
+      if (!is_red(sibling->left) && !is_red(sibling->right)) {
+        sibling->red = true;
+        e = parent;
+        parent = e->parent;
+      } else {
+        if (!is_red(sibling->left)) {
+          sibling->right->red = false;
+          sibling->red = true;
+          rotate_left(t, sibling);
+          sibling = parent->left;
+        }
+        sibling->red = parent->red;
+        parent->red = false;
+        sibling->left->red = false;
+        rotate_right(t, parent);
+        e = t->root;
+      }
+    }
+  }
+  if (e != NULL)
+    e->red = false;
+}
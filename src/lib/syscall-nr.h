@@ -29,6 +29,12 @@ enum {
   SYS_SEMA_DOWN,    /* Downs a semaphore */
   SYS_SEMA_UP,      /* Ups a semaphore */
   SYS_GET_TID,      /* Gets TID of the current thread */
+  SYS_CG_CREATE,    /* Creates a CPU group */
+  SYS_CG_SET_QUOTA, /* Sets a CPU group's quota */
+  SYS_CG_JOIN,      /* Moves this process into a CPU group */
+  SYS_CG_USAGE,     /* Reports a CPU group's usage */
+  SYS_FUTEX_WAIT,   /* Waits on a user synchronization word */
+  SYS_FUTEX_WAKE,   /* Wakes waiters on a user synchronization word */
 
   /* Project 3 and optionally project 4. */
   SYS_MMAP,   /* Map a file into memory. */
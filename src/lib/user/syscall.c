@@ -1,6 +1,8 @@
 #include <syscall.h>
 #include "../syscall-nr.h"
+#include <atomic.h>
 #include <pthread.h>
+#include <stddef.h>
 
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
@@ -118,7 +120,12 @@ int inumber(int fd) { return syscall1(SYS_INUMBER, fd); }
 
 double compute_e(int n) { return (double)syscall1f(SYS_COMPUTE_E, n); }
 
+/* True once the process may have more than one thread.  See
+   known_tid(). */
+static bool threaded;
+
 tid_t sys_pthread_create(stub_fun sfun, pthread_fun tfun, const void* arg) {
+  threaded = true;
   return syscall3(SYS_PT_CREATE, sfun, tfun, arg);
 }
 
@@ -129,32 +136,144 @@ void sys_pthread_exit() {
 
 tid_t sys_pthread_join(tid_t tid) { return syscall1(SYS_PT_JOIN, tid); }
 
-bool lock_init(lock_t* lock) { return syscall1(SYS_LOCK_INIT, lock); }
+/* Locks and semaphores.
+
+   Both are taken and released in user memory with atomic
+   instructions and enter the kernel only to wait or to wake a
+   waiter, through futex_wait() and futex_wake().
+
+   A lock's state is 0 if it is free, 1 if it is held, and 2 if it
+   is held and another thread may be waiting for it, following
+   Drepper, "Futexes Are Tricky".  Releasing a lock in state 1
+   makes no system call.
+
+   The holder of a lock is recorded by thread ID, so that misuse
+   can be detected, but only when that costs no system call: always
+   in a process with a single thread, and otherwise only for locks
+   acquired after waiting, when we enter the kernel anyway.  An
+   uncontended lock in a process with several threads has no
+   recorded holder, so acquiring it twice deadlocks and releasing
+   it from another thread goes unnoticed.  Releasing a free lock is
+   always caught.  As before, misuse terminates the process with
+   exit code 1. */
+
+#define LOCK_MAGIC 0x6c6f636b /* "lock". */
+#define SEMA_MAGIC 0x73656d61 /* "sema". */
+
+/* Returns the running thread's ID if it is known without a system
+   call, and TID_ERROR otherwise.  There is no thread-local storage
+   to cache it in for each thread, so it is cached for the whole
+   process, which is only correct until a second thread is
+   created. */
+static tid_t known_tid(void) {
+  static tid_t cached_tid = TID_ERROR;
+
+  if (threaded)
+    return TID_ERROR;
+  if (cached_tid == TID_ERROR)
+    cached_tid = get_tid();
+  return cached_tid;
+}
+
+bool lock_init(lock_t* lock) {
+  if (lock == NULL)
+    return false;
+  lock->state = 0;
+  lock->owner = TID_ERROR;
+  lock->magic = LOCK_MAGIC;
+  return true;
+}
 
 void lock_acquire(lock_t* lock) {
-  bool success = syscall1(SYS_LOCK_ACQUIRE, lock);
-  if (!success)
+  tid_t self;
+  int c;
+
+  if (lock == NULL || lock->magic != LOCK_MAGIC)
     exit(1);
+
+  c = atomic_cmpxchg(&lock->state, 0, 1);
+  if (c == 0) {
+    lock->owner = known_tid();
+    return;
+  }
+
+  self = known_tid();
+  if (self == TID_ERROR)
+    self = get_tid();
+  if (lock->owner == self)
+    exit(1);
+
+  /* Mark the lock contended, then sleep until it is free. */
+  if (c != 2)
+    c = atomic_xchg(&lock->state, 2);
+  while (c != 0) {
+    futex_wait(&lock->state, 2);
+    c = atomic_xchg(&lock->state, 2);
+  }
+  lock->owner = self;
 }
 
 void lock_release(lock_t* lock) {
-  bool success = syscall1(SYS_LOCK_RELEASE, lock);
-  if (!success)
+  tid_t self = known_tid();
+
+  if (lock == NULL || lock->magic != LOCK_MAGIC || lock->state == 0)
+    exit(1);
+  if (self != TID_ERROR && lock->owner != self)
     exit(1);
+
+  lock->owner = TID_ERROR;
+  if (atomic_xchg(&lock->state, 0) == 2)
+    futex_wake(&lock->state, 1);
 }
 
-bool sema_init(sema_t* sema, int val) { return syscall2(SYS_SEMA_INIT, sema, val); }
+bool sema_init(sema_t* sema, int val) {
+  if (sema == NULL || val < 0)
+    return false;
+  sema->value = val;
+  sema->waiters = 0;
+  sema->magic = SEMA_MAGIC;
+  return true;
+}
 
 void sema_down(sema_t* sema) {
-  bool success = syscall1(SYS_SEMA_DOWN, sema);
-  if (!success)
+  if (sema == NULL || sema->magic != SEMA_MAGIC)
     exit(1);
+
+  for (;;) {
+    int v = sema->value;
+
+    if (v > 0) {
+      if (atomic_cmpxchg(&sema->value, v, v - 1) == v)
+        return;
+    } else {
+      atomic_fetch_add(&sema->waiters, 1);
+      futex_wait(&sema->value, 0);
+      atomic_fetch_add(&sema->waiters, -1);
+    }
+  }
 }
 
 void sema_up(sema_t* sema) {
-  bool success = syscall1(SYS_SEMA_UP, sema);
-  if (!success)
+  if (sema == NULL || sema->magic != SEMA_MAGIC)
     exit(1);
+
+  atomic_fetch_add(&sema->value, 1);
+  if (sema->waiters > 0)
+    futex_wake(&sema->value, 1);
 }
 
 tid_t get_tid(void) { return syscall0(SYS_GET_TID); }
+
+int cg_create(void) { return syscall0(SYS_CG_CREATE); }
+
+bool cg_set_quota(int group, int quota, int period) {
+  return syscall3(SYS_CG_SET_QUOTA, group, quota, period);
+}
+
+bool cg_join(int group) { return syscall1(SYS_CG_JOIN, group); }
+
+int cg_usage(int group) { return syscall1(SYS_CG_USAGE, group); }
+
+bool futex_wait(int* addr, int val) { return syscall2(SYS_FUTEX_WAIT, addr, val); }
+
+int futex_wake(int* addr, int n) { return syscall2(SYS_FUTEX_WAKE, addr, n); }
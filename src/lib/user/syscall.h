@@ -9,9 +9,21 @@
 typedef int pid_t;
 #define PID_ERROR ((pid_t)-1)
 
-/* Synchronization Types */
-typedef char lock_t;
-typedef char sema_t;
+/* Synchronization Types.  Locks and semaphores live in user
+   memory and are taken and released with atomic instructions.
+   Only a thread that has to wait, or to wake a waiter, makes a
+   system call, futex_wait() or futex_wake(). */
+typedef struct {
+  int state;      /* 0 if free, 1 if held, 2 if held and contended. */
+  tid_t owner;    /* Thread holding the lock, or TID_ERROR. */
+  unsigned magic; /* LOCK_MAGIC once initialized. */
+} lock_t;
+
+typedef struct {
+  int value;      /* Current value. */
+  int waiters;    /* Number of threads waiting, or about to. */
+  unsigned magic; /* SEMA_MAGIC once initialized. */
+} sema_t;
 
 /* Map region identifier. */
 typedef int mapid_t;
@@ -50,6 +62,12 @@ bool sema_init(sema_t* sema, int val);
 void sema_down(sema_t* sema);
 void sema_up(sema_t* sema);
 tid_t get_tid(void);
+int cg_create(void);
+bool cg_set_quota(int group, int quota, int period);
+bool cg_join(int group);
+int cg_usage(int group);
+bool futex_wait(int* addr, int val);
+int futex_wake(int* addr, int n);
 
 /* Project 3 and optionally project 4. */
 mapid_t mmap(int fd, void* addr);
@@ -0,0 +1,70 @@
+/* Checks the per-thread CPU accounting: sleeping counts as
+   voluntary switches, yielding to another ready thread counts as
+   involuntary switches and time spent ready, and spinning counts
+   as kernel ticks. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/clock.h"
+#include "devices/timer.h"
+
+/* Number of sleeps, and of yields by each thread. */
+#define ITER_CNT 10
+
+/* Ticks to spin for. */
+#define SPIN_TICKS 5
+
+static thread_func yielder;
+
+void test_alarm_accounting(void) {
+  struct thread* cur = thread_current();
+  struct semaphore done;
+  int64_t voluntary, involuntary, kernel, start;
+  uint64_t ready_ns;
+  int i;
+
+  voluntary = cur->voluntary_switches;
+  for (i = 0; i < ITER_CNT; i++)
+    timer_sleep(1);
+  if (cur->voluntary_switches - voluntary < ITER_CNT)
+    fail("%d sleeps counted as only %d voluntary switches", ITER_CNT,
+         (int)(cur->voluntary_switches - voluntary));
+  msg("Sleeping counts as voluntary switches.");
+
+  involuntary = cur->involuntary_switches;
+  ready_ns = cur->ready_ns;
+  sema_init(&done, 0);
+  thread_create("yielder", PRI_DEFAULT, yielder, &done);
+  for (i = 0; i < ITER_CNT; i++)
+    thread_yield();
+  sema_down(&done);
+  if (cur->involuntary_switches - involuntary < ITER_CNT)
+    fail("%d yields counted as only %d involuntary switches", ITER_CNT,
+         (int)(cur->involuntary_switches - involuntary));
+  /* Without a TSC, time is only measured in whole ticks. */
+  if (clock_has_tsc() && cur->ready_ns == ready_ns)
+    fail("yielding did not count as time spent ready");
+  msg("Yielding counts as involuntary switches and time spent ready.");
+
+  kernel = cur->kernel_ticks;
+  start = timer_ticks();
+  while (timer_elapsed(start) < SPIN_TICKS)
+    continue;
+  if (cur->kernel_ticks - kernel < SPIN_TICKS - 1)
+    fail("spinning for %d ticks counted as only %d kernel ticks", SPIN_TICKS,
+         (int)(cur->kernel_ticks - kernel));
+  msg("Spinning counts as kernel ticks.");
+}
+
+/* Yields ITER_CNT times, then ups the semaphore passed in. */
+static void yielder(void* done_) {
+  struct semaphore* done = done_;
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    thread_yield();
+  sema_up(done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-accounting) begin
+(alarm-accounting) Sleeping counts as voluntary switches.
+(alarm-accounting) Yielding counts as involuntary switches and time spent ready.
+(alarm-accounting) Spinning counts as kernel ticks.
+(alarm-accounting) end
+EOF
+pass;
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+fail "Kernel did not use the preset loops_per_tick.\n"
+  if !grep (/loops\/s \(preset, -lpt=1000000\)/, @output);
+
+my ($calibration);
+foreach (@output) {
+    ($calibration) = /calibration ([\d,]+) us/ and last;
+}
+if (defined $calibration) {
+    $calibration =~ s/,//g;
+    fail "Calibration took $calibration us with a preset value.\n"
+      if $calibration > 20000;
+}
+@output = get_core_output ("run", @output);
+fail "Delays did not complete.\n" if !grep (/Delays completed\./, @output);
+pass;
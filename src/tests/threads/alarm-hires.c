@@ -0,0 +1,40 @@
+/* Checks that timer_usleep() is accurate to well under a timer
+   tick, using the high-resolution clock to time each sleep.
+
+   Some of the durations are shorter than a tick and some are not
+   a whole number of ticks, so a tick-granularity implementation
+   would wake up far too early or too late.  Each sleep must last
+   at least as long as requested and end within TOLERANCE_US
+   microseconds of its deadline. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/clock.h"
+#include "devices/timer.h"
+
+/* Maximum acceptable oversleep, in microseconds. */
+#define TOLERANCE_US 1000
+
+void test_alarm_hires(void) {
+  static const int durations[] = {50, 400, 2500, 15000, 27500};
+  size_t i;
+
+  if (!clock_has_tsc()) {
+    msg("No TSC clock source; skipping.");
+    return;
+  }
+
+  for (i = 0; i < sizeof durations / sizeof *durations; i++) {
+    uint64_t start = clock_ns();
+    int64_t elapsed_us;
+
+    timer_usleep(durations[i]);
+    elapsed_us = (clock_ns() - start) / 1000;
+    if (elapsed_us < durations[i] || elapsed_us > durations[i] + TOLERANCE_US)
+      fail("timer_usleep(%d) took %" PRId64 " us", durations[i], elapsed_us);
+  }
+  msg("All sleeps ended within %d us of their deadlines.", TOLERANCE_US);
+}
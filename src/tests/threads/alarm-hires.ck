@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+fail "Sleeps were not accurate.\n"
+  if !grep (/All sleeps ended within \d+ us of their deadlines\.|skipping/, @output);
+pass;
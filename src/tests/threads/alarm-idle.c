@@ -0,0 +1,70 @@
+/* Creates N threads that repeatedly sleep for short, staggered
+   durations and measures the fraction of timer ticks that the
+   CPU spends in the idle thread while they do so.
+
+   Sleeping threads should block rather than spin, so even with
+   hundreds of sleepers nearly every tick ought to be idle. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void test_idle(int thread_cnt);
+
+void test_alarm_idle_10(void) { test_idle(10); }
+
+void test_alarm_idle_100(void) { test_idle(100); }
+
+void test_alarm_idle_500(void) { test_idle(500); }
+
+/* Number of times each sleeper goes to sleep. */
+#define ITERATIONS 10
+
+static thread_func sleeper;
+
+/* Signaled by each sleeper when it is done. */
+static struct semaphore done_sema;
+
+static void test_idle(int thread_cnt) {
+  long long start_idle, idle;
+  int64_t start, elapsed;
+  int i;
+
+  ASSERT(active_sched_policy == SCHED_FIFO);
+
+  msg("Creating %d threads to sleep %d times each.", thread_cnt, ITERATIONS);
+
+  sema_init(&done_sema, 0);
+  start = timer_ticks();
+  start_idle = thread_get_idle_ticks();
+  for (i = 0; i < thread_cnt; i++) {
+    char name[24];
+
+    snprintf(name, sizeof name, "sleeper %d", i);
+    if (thread_create(name, PRI_DEFAULT, sleeper, (void*)i) == TID_ERROR)
+      fail("couldn't create thread %d", i);
+  }
+
+  for (i = 0; i < thread_cnt; i++)
+    sema_down(&done_sema);
+  elapsed = timer_elapsed(start);
+  idle = thread_get_idle_ticks() - start_idle;
+
+  msg("%lld of %lld ticks idle.", idle, elapsed);
+  msg("Idle ratio: %lld%%.", elapsed > 0 ? idle * 100 / elapsed : 0);
+}
+
+/* Sleeps ITERATIONS times for 5 to 14 ticks, depending on the
+   sleeper's ID, then signals completion. */
+static void sleeper(void* id_) {
+  int id = (int)id_;
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    timer_sleep(5 + id % 10);
+  sema_up(&done_sema);
+}
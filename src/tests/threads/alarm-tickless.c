@@ -0,0 +1,48 @@
+/* Checks that with "-timer=tickless" the idle thread stops taking
+   a timer interrupt on every tick while threads sleep, and that
+   sleeping threads still wake up on the right tick.
+
+   The main thread sleeps for a series of durations, some shorter
+   and some much longer than a single one-shot timer period, and
+   checks that each sleep ends on its deadline.  Over the whole
+   run the CPU is almost always idle, so the idle thread should
+   wake up far less often than TIMER_FREQ times per idle
+   second. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+void test_alarm_tickless(void) {
+  static const int durations[] = {1, 2, 3, 7, 20, 50, 150};
+  long long start_wakeups, start_idle, wakeups, idle;
+  size_t i;
+
+  ASSERT(timer_tickless);
+
+  start_wakeups = thread_get_idle_wakeups();
+  start_idle = thread_get_idle_ticks();
+  for (i = 0; i < sizeof durations / sizeof *durations; i++) {
+    int64_t start, elapsed;
+
+    /* Start on a tick boundary. */
+    start = timer_ticks();
+    while (timer_ticks() == start)
+      continue;
+
+    start = timer_ticks();
+    timer_sleep(durations[i]);
+    elapsed = timer_elapsed(start);
+    if (elapsed < durations[i] || elapsed > durations[i] + 1)
+      fail("sleep of %d ticks woke up after %" PRId64 " ticks", durations[i], elapsed);
+  }
+  msg("All sleeps woke up on time.");
+
+  wakeups = thread_get_idle_wakeups() - start_wakeups;
+  idle = thread_get_idle_ticks() - start_idle;
+  msg("%lld idle wakeups in %lld idle ticks.", wakeups, idle);
+  msg("Idle wakeups per second: %lld.", idle > 0 ? wakeups * TIMER_FREQ / idle : 0);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+fail "Sleeps did not wake up on time.\n"
+  if !grep (/All sleeps woke up on time\./, @output);
+
+my ($rate);
+foreach (@output) {
+    ($rate) = /Idle wakeups per second: (\d+)\./ and last;
+}
+fail "Idle wakeup rate missing from output.\n" if !defined $rate;
+fail "Idle thread woke up $rate times per second, expected at most 50.\n"
+  if $rate > 50;
+pass;
@@ -29,4 +29,23 @@ sub check_alarm {
     pass;
 }
 
+sub check_alarm_idle {
+    my ($min_pct) = @_;
+    our ($test);
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my ($pct);
+    local ($_);
+    foreach (@output) {
+	($pct) = /Idle ratio: (\d+)%\./ and last;
+    }
+    fail "Idle ratio missing from output.\n" if !defined $pct;
+    fail "Only $pct% of ticks were idle, expected at least $min_pct%.\n"
+      if $pct < $min_pct;
+    pass;
+}
+
 1;
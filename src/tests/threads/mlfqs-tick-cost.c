@@ -0,0 +1,85 @@
+/* Checks that the MLFQS scheduler's per-tick bookkeeping does not
+   grow with the number of threads in the system.
+
+   The main thread spins for a few seconds counting loop
+   iterations, first alone and then with many threads blocked on
+   a semaphore.  Time spent in the timer interrupt comes out of
+   the main thread's loop, so if the interrupt walked every thread
+   to update recent_cpu and priorities, the loop rate would drop
+   as blocked threads were added.  Blocked threads should cost
+   nothing until they wake up. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of blocked threads in the loaded measurement. */
+#define BLOCKED_CNT 200
+
+/* Length of each measurement, in ticks.  Covers several of the
+   once-per-second updates. */
+#define MEASURE_TICKS (3 * TIMER_FREQ)
+
+static int measure(int blocked_cnt);
+static thread_func blocked_thread;
+
+static struct semaphore started_sema; /* Upped by each new thread. */
+static struct semaphore wake_sema;    /* Blocked threads wait here. */
+static struct semaphore done_sema;    /* Upped by each exiting thread. */
+
+void test_mlfqs_tick_cost(void) {
+  int base, loaded;
+
+  ASSERT(active_sched_policy == SCHED_MLFQS);
+
+  base = measure(0);
+  msg("0 blocked threads: %d loops per tick.", base);
+  loaded = measure(BLOCKED_CNT);
+  msg("%d blocked threads: %d loops per tick.", BLOCKED_CNT, loaded);
+
+  if (loaded * 4 < base * 3)
+    fail("timer interrupt cost grew by more than 25%% with %d blocked threads", BLOCKED_CNT);
+  msg("Tick cost is independent of blocked threads.");
+}
+
+/* Returns the number of iterations per tick of a busy loop run
+   with BLOCKED_CNT threads blocked on a semaphore. */
+static int measure(int blocked_cnt) {
+  int64_t start;
+  int loops = 0;
+  int i;
+
+  sema_init(&started_sema, 0);
+  sema_init(&wake_sema, 0);
+  sema_init(&done_sema, 0);
+  for (i = 0; i < blocked_cnt; i++)
+    if (thread_create("blocked", PRI_DEFAULT, blocked_thread, NULL) == TID_ERROR)
+      fail("couldn't create thread %d", i);
+  for (i = 0; i < blocked_cnt; i++)
+    sema_down(&started_sema);
+
+  /* Start on a tick boundary. */
+  start = timer_ticks();
+  while (timer_ticks() == start)
+    continue;
+
+  start = timer_ticks();
+  while (timer_elapsed(start) < MEASURE_TICKS)
+    loops++;
+
+  for (i = 0; i < blocked_cnt; i++)
+    sema_up(&wake_sema);
+  for (i = 0; i < blocked_cnt; i++)
+    sema_down(&done_sema);
+
+  return loops / MEASURE_TICKS;
+}
+
+static void blocked_thread(void* aux UNUSED) {
+  sema_up(&started_sema);
+  sema_down(&wake_sema);
+  sema_up(&done_sema);
+}
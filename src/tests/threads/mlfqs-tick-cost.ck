@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+foreach my $n (0, 200) {
+    fail "Missing measurement with $n blocked threads.\n"
+      if !grep (/\($test\) $n blocked threads: \d+ loops per tick\./, @output);
+}
+fail "Tick cost grew with the number of blocked threads.\n"
+  if !grep (/Tick cost is independent of blocked threads\./, @output);
+pass;
@@ -0,0 +1,75 @@
+/* Creates BALANCE_THREADS CPU-bound threads, all on one CPU, and
+   measures how long they take to finish as the other CPUs steal
+   work from the creator's run queue.  Reports the number of CPUs
+   the threads ran on and how many steals and migrations it took
+   to get them there. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/clock.h"
+
+/* Number of worker threads. */
+#define BALANCE_THREADS 16
+
+/* Iterations of busy work done by each worker. */
+#define BALANCE_ITERS 20000000
+
+/* Bit I is set once some worker has run on CPU I. */
+static unsigned cpus_used;
+
+/* Marks the CPU running the current thread as used. */
+static void mark_cpu(void) {
+  enum intr_level old_level = intr_disable();
+  cpus_used |= 1u << cpu_current()->id;
+  intr_set_level(old_level);
+}
+
+static void balance_thread(void* done_) {
+  struct semaphore* done = done_;
+  volatile int x = 0;
+  int i;
+
+  for (i = 0; i < BALANCE_ITERS; i++) {
+    x++;
+    if (i % (BALANCE_ITERS / 16) == 0)
+      mark_cpu();
+  }
+  mark_cpu();
+  sema_up(done);
+}
+
+void test_mt_balance(void) {
+  struct semaphore done[BALANCE_THREADS];
+  long long steals, migrations;
+  uint64_t start;
+  int i, used;
+
+  msg("%d CPUs online.", cpu_cnt);
+  steals = thread_get_steals();
+  migrations = thread_get_migrations();
+
+  start = clock_ns();
+  for (i = 0; i < BALANCE_THREADS; i++) {
+    char name[16];
+
+    sema_init(&done[i], 0);
+    snprintf(name, sizeof name, "balance %d", i);
+    thread_create(name, PRI_DEFAULT, balance_thread, &done[i]);
+  }
+  for (i = 0; i < BALANCE_THREADS; i++)
+    sema_down(&done[i]);
+
+  used = 0;
+  for (i = 0; i < CPU_MAX; i++)
+    if (cpus_used & (1u << i))
+      used++;
+  msg("%d threads: %lld us on %d CPUs.", BALANCE_THREADS,
+      (long long)((clock_ns() - start) / 1000), used);
+  msg("%lld steals, %lld migrations.", thread_get_steals() - steals,
+      thread_get_migrations() - migrations);
+}
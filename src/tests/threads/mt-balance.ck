@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings vary from run to run, so check the format, and that the
+# threads spread out when there was more than one CPU to use.
+my ($online) = map (/^\(mt-balance\) (\d+) CPUs online\.$/, @output);
+fail "Number of CPUs not reported.\n" if !defined $online;
+my ($used) = map (/^\(mt-balance\) 16 threads: \d+ us on (\d+) CPUs\.$/, @output);
+fail "No timing reported.\n" if !defined $used;
+fail "Threads ran on $used CPUs but only $online were online.\n"
+  if $used > $online;
+fail "Threads never left the creating CPU.\n" if $online > 1 && $used < 2;
+fail "Steals and migrations not reported.\n"
+  if !grep (/^\(mt-balance\) \d+ steals, \d+ migrations\.$/, @output);
+pass;
@@ -0,0 +1,46 @@
+/* Measures thread creation and exit throughput, first with the
+   thread page cache disabled and then with it enabled.  Each
+   thread runs at a higher priority than the main thread, so it
+   runs and exits as soon as it is created and its page is ready
+   to be reused by the next thread_create(). */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/clock.h"
+
+/* Number of threads created in each run. */
+#define CHURN_THREADS 2000
+
+static void churn_thread(void* count_) {
+  int* count = count_;
+  (*count)++;
+}
+
+/* Creates and reaps CHURN_THREADS threads with the thread cache
+   limited to LIMIT pages, and reports the throughput. */
+static void churn(const char* label, size_t limit) {
+  long long hits;
+  uint64_t ns;
+  int count = 0;
+  int i;
+
+  thread_set_cache_limit(limit);
+  hits = thread_get_cache_hits();
+  ns = clock_ns();
+  for (i = 0; i < CHURN_THREADS; i++)
+    thread_create("churn", PRI_DEFAULT + 1, churn_thread, &count);
+  ns = clock_ns() - ns;
+
+  if (count != CHURN_THREADS)
+    fail("only %d of %d threads ran", count, CHURN_THREADS);
+  msg("%s: %d threads in %lld us, %lld threads/s, %lld cache hits.", label, CHURN_THREADS,
+      (long long)(ns / 1000), ns > 0 ? CHURN_THREADS * 1000000000LL / (long long)ns : 0,
+      thread_get_cache_hits() - hits);
+}
+
+void test_mt_churn(void) {
+  churn("uncached", 0);
+  churn("cached", 32);
+}
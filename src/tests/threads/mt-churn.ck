@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings vary from run to run, so check the format, and that
+# only the cached run reused pages.
+my ($uncached) = map (/^\(mt-churn\) uncached: 2000 threads in \d+ us, \d+ threads\/s, (\d+) cache hits\.$/, @output);
+fail "No uncached run reported.\n" if !defined $uncached;
+fail "Uncached run reused $uncached pages.\n" if $uncached != 0;
+my ($cached) = map (/^\(mt-churn\) cached: 2000 threads in \d+ us, \d+ threads\/s, (\d+) cache hits\.$/, @output);
+fail "No cached run reported.\n" if !defined $cached;
+fail "Cached run reused only $cached pages.\n" if $cached < 1999;
+pass;
@@ -0,0 +1,126 @@
+/* Measures the throughput of a bounded buffer guarded by a lock
+   and two condition variables, first with signaled waiters woken
+   to block on the lock and then with them moved straight onto the
+   lock's wait queue.
+
+   Each run has equal numbers of producer and consumer threads
+   pass items through a buffer of BUFFER_SIZE slots for RUN_TICKS
+   ticks.  Items per tick measure throughput; the number of times
+   the threads blocked measures the wasted wakeups. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Length of each run, in timer ticks. */
+#define RUN_TICKS TIMER_FREQ
+
+/* Fewest and most threads, producers and consumers together. */
+#define MIN_THREADS 2
+#define MAX_THREADS 64
+
+/* Number of items the buffer holds. */
+#define BUFFER_SIZE 8
+
+/* A bounded buffer, and the state shared by the threads of one
+   run.  All of it is protected by LOCK. */
+struct buffer {
+  struct lock lock;           /* Monitor lock. */
+  struct condition not_full;  /* Signaled when an item is taken. */
+  struct condition not_empty; /* Signaled when an item is added. */
+  int count;                  /* Number of items in the buffer. */
+  bool stop;                  /* Set by the main thread to end the run. */
+  long long items;            /* Total items passed through. */
+  long long blocks;           /* Total times the threads blocked. */
+  struct semaphore done;      /* Upped by each thread as it exits. */
+};
+
+/* Adds the calling thread's block count to B's total, releases
+   B's lock, which must be held, and reports the thread done. */
+static void finish(struct buffer* b) {
+  b->blocks += thread_current()->voluntary_switches;
+  lock_release(&b->lock);
+  sema_up(&b->done);
+}
+
+static void producer_thread(void* b_) {
+  struct buffer* b = b_;
+
+  lock_acquire(&b->lock);
+  for (;;) {
+    while (b->count == BUFFER_SIZE && !b->stop)
+      cond_wait(&b->not_full, &b->lock);
+    if (b->stop)
+      break;
+    b->count++;
+    cond_signal(&b->not_empty, &b->lock);
+  }
+  finish(b);
+}
+
+static void consumer_thread(void* b_) {
+  struct buffer* b = b_;
+
+  lock_acquire(&b->lock);
+  for (;;) {
+    while (b->count == 0 && !b->stop)
+      cond_wait(&b->not_empty, &b->lock);
+    if (b->stop)
+      break;
+    b->count--;
+    b->items++;
+    cond_signal(&b->not_full, &b->lock);
+  }
+  finish(b);
+}
+
+/* Runs THREADS threads, half producers and half consumers, for
+   RUN_TICKS ticks with wait morphing if MORPH is true, and
+   reports the results. */
+static void buffer_run(bool morph, int threads) {
+  struct buffer b;
+  int i;
+
+  lock_init(&b.lock);
+  cond_init(&b.not_full);
+  cond_init(&b.not_empty);
+  b.count = 0;
+  b.stop = false;
+  b.items = b.blocks = 0;
+  sema_init(&b.done, 0);
+
+  cond_morph = morph;
+  for (i = 0; i < threads / 2; i++) {
+    thread_create("producer", PRI_DEFAULT, producer_thread, &b);
+    thread_create("consumer", PRI_DEFAULT, consumer_thread, &b);
+  }
+  timer_sleep(RUN_TICKS);
+
+  lock_acquire(&b.lock);
+  b.stop = true;
+  cond_broadcast(&b.not_full, &b.lock);
+  cond_broadcast(&b.not_empty, &b.lock);
+  lock_release(&b.lock);
+  for (i = 0; i < threads; i++)
+    sema_down(&b.done);
+
+  msg("%s, %d threads: %lld items/tick, %lld blocks.", morph ? "morph" : "wake", threads,
+      b.items / RUN_TICKS, b.blocks);
+}
+
+void test_mt_condvar(void) {
+  bool morph = cond_morph;
+  int threads;
+
+  /* The main thread must preempt the others to end each run. */
+  thread_set_priority(PRI_MAX);
+  for (threads = MIN_THREADS; threads <= MAX_THREADS; threads *= 2) {
+    buffer_run(false, threads);
+    buffer_run(true, threads);
+  }
+  cond_morph = morph;
+  thread_set_priority(PRI_DEFAULT);
+}
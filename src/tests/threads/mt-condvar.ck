@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings vary from run to run, so check that every run reported
+# and passed items through the buffer, and that with 4 or more
+# threads wait morphing blocked less often per item passed.  A
+# thread woken by cond_signal() runs only to find the monitor lock
+# held, and blocks on it, whenever the holder is preempted first;
+# a morphed waiter is not runnable until it is handed the lock.
+for my $threads (2, 4, 8, 16, 32, 64) {
+    my (%per_item);
+    for my $mode ("wake", "morph") {
+        my ($items, $blocks) = map (/^\(mt-condvar\) $mode, $threads threads: (\d+) items\/tick, (\d+) blocks\.$/, @output);
+        fail "No $mode run with $threads threads reported.\n" if !defined $items;
+        fail "No items passed with $mode and $threads threads.\n" if $items == 0;
+        $per_item{$mode} = $blocks / $items;
+    }
+    fail "Wait morphing blocked no less per item than waking with $threads threads.\n"
+      if $threads >= 4 && $per_item{morph} >= $per_item{wake};
+}
+pass;
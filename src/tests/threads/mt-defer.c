@@ -0,0 +1,82 @@
+/* Measures the longest time interrupts stay off while many
+   sleeping threads wake up on the same timer tick, first with the
+   timer interrupt waking them inside its handler and then with it
+   deferring the wake-ups to the interrupt's return, where they
+   are done one thread at a time. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/defer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/clock.h"
+#include "devices/timer.h"
+
+/* Number of threads that wake on the same tick. */
+#define BURST_THREADS 200
+
+/* Number of bursts measured in each mode. */
+#define BURST_ROUNDS 3
+
+/* Ticks allowed for creating the threads of a burst. */
+#define BURST_DELAY 10
+
+struct burst {
+  int64_t wake_tick;     /* Tick at which every thread wakes. */
+  struct semaphore done; /* Upped by each thread as it exits. */
+};
+
+static void burst_thread(void* burst_) {
+  struct burst* burst = burst_;
+
+  timer_sleep_until(burst->wake_tick);
+  sema_up(&burst->done);
+}
+
+/* Runs BURST_ROUNDS bursts with deferral enabled if DEFERRED is
+   true, and reports the longest interrupts-off window seen while
+   the threads of a burst woke up. */
+static void measure(const char* label, bool deferred) {
+  uint64_t max_ns = 0;
+  int round, i;
+
+  defer_enabled = deferred;
+  for (round = 0; round < BURST_ROUNDS; round++) {
+    struct burst burst;
+
+    burst.wake_tick = timer_ticks() + BURST_DELAY;
+    sema_init(&burst.done, 0);
+    for (i = 0; i < BURST_THREADS; i++)
+      if (thread_create("burst", PRI_DEFAULT, burst_thread, &burst) == TID_ERROR)
+        fail("couldn't create thread %d", i);
+
+    /* Time only the burst itself, not creating the threads. */
+    timer_sleep_until(burst.wake_tick - 1);
+    intr_reset_max_off();
+    timer_sleep_until(burst.wake_tick + 1);
+    if (intr_get_max_off_ns() > max_ns)
+      max_ns = intr_get_max_off_ns();
+
+    for (i = 0; i < BURST_THREADS; i++)
+      sema_down(&burst.done);
+  }
+
+  msg("%s: %d threads woke per tick, interrupts off for at most %lld us.", label, BURST_THREADS,
+      (long long)(max_ns / 1000));
+}
+
+void test_mt_defer(void) {
+  bool deferred = defer_enabled;
+
+  if (!clock_has_tsc())
+    fail("interrupts-off windows are only timed with a TSC");
+
+  /* The main thread must run as soon as it wakes up. */
+  thread_set_priority(PRI_MAX);
+  measure("inline", false);
+  measure("deferred", true);
+  defer_enabled = deferred;
+  thread_set_priority(PRI_DEFAULT);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings vary from run to run, so check that both modes reported,
+# and that deferring the wake-ups, which turns interrupts off for
+# one thread at a time, kept them off for less time than waking
+# all 200 threads inside the handler.
+my (%max);
+for my $mode ("inline", "deferred") {
+    ($max{$mode}) = map (/^\(mt-defer\) $mode: 200 threads woke per tick, interrupts off for at most (\d+) us\.$/, @output);
+    fail "No $mode run reported.\n" if !defined $max{$mode};
+}
+fail "Deferred wake-ups kept interrupts off for $max{deferred} us, "
+  . "no less than the $max{inline} us of inline wake-ups.\n"
+  if $max{deferred} >= $max{inline};
+pass;
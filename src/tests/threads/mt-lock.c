@@ -0,0 +1,100 @@
+/* Measures the throughput of a contended lock with short critical
+   sections, like those of the page allocator and malloc(), first
+   with locks that always sleep when contended and then with
+   adaptive ones that spin while the holder is running on another
+   CPU.
+
+   Each run has a number of threads acquire the same lock, do a
+   few hundred cycles of work while holding it, release it, and do
+   a little more work, over and over for RUN_TICKS ticks.  The
+   total number of acquisitions per tick measures throughput.  The
+   contention counts are those of every lock in the kernel over
+   the run, which are nearly all of the test's lock. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Length of each run, in timer ticks. */
+#define RUN_TICKS TIMER_FREQ
+
+/* Largest number of threads. */
+#define MAX_THREADS 8
+
+/* Loop iterations inside and outside the critical section. */
+#define INSIDE_LOOPS 100
+#define OUTSIDE_LOOPS 20
+
+/* State shared by the threads of one run. */
+struct run {
+  struct lock lock;       /* The contended lock. */
+  volatile bool stop;     /* Set by the main thread to end the run. */
+  struct semaphore done;  /* Upped by each thread as it exits. */
+  long long acquisitions; /* Total acquisitions, protected by LOCK. */
+};
+
+/* Spins for LOOPS iterations. */
+static void work(int loops) {
+  volatile int i;
+
+  for (i = 0; i < loops; i++)
+    continue;
+}
+
+static void lock_thread(void* run_) {
+  struct run* run = run_;
+
+  while (!run->stop) {
+    lock_acquire(&run->lock);
+    work(INSIDE_LOOPS);
+    run->acquisitions++;
+    lock_release(&run->lock);
+    work(OUTSIDE_LOOPS);
+  }
+  sema_up(&run->done);
+}
+
+/* Runs THREADS threads against one lock for RUN_TICKS ticks with
+   adaptive locks if ADAPTIVE is true, and reports the results. */
+static void lock_run(bool adaptive, int threads) {
+  struct lock_totals before, after;
+  struct run run;
+  int i;
+
+  lock_init(&run.lock);
+  run.stop = false;
+  sema_init(&run.done, 0);
+  run.acquisitions = 0;
+
+  lock_adaptive = adaptive;
+  lock_get_totals(&before);
+  for (i = 0; i < threads; i++)
+    thread_create("locker", PRI_DEFAULT, lock_thread, &run);
+  timer_sleep(RUN_TICKS);
+  run.stop = true;
+  for (i = 0; i < threads; i++)
+    sema_down(&run.done);
+  lock_get_totals(&after);
+
+  msg("%s, %d threads: %lld acquisitions/tick, %lld contended, %lld spun, %lld slept.",
+      adaptive ? "adaptive" : "block", threads, run.acquisitions / RUN_TICKS,
+      after.contended - before.contended, after.spun - before.spun,
+      after.slept - before.slept);
+}
+
+void test_mt_lock(void) {
+  bool adaptive = lock_adaptive;
+  int threads;
+
+  /* The main thread must preempt the lockers to end each run. */
+  thread_set_priority(PRI_MAX);
+  for (threads = 1; threads <= MAX_THREADS; threads *= 2) {
+    lock_run(false, threads);
+    lock_run(true, threads);
+  }
+  lock_adaptive = adaptive;
+  thread_set_priority(PRI_DEFAULT);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings vary from run to run, so check only that every run
+# reported, that every run made progress, that locks that always
+# block never spun, and that adaptive locks contended by two or
+# more threads did spin, since the test runs with 4 CPUs and the
+# critical sections are short.
+for my $threads (1, 2, 4, 8) {
+    for my $mode ("block", "adaptive") {
+        my ($rate, $spun) = map (/^\(mt-lock\) $mode, $threads threads: (\d+) acquisitions\/tick, \d+ contended, (\d+) spun, \d+ slept\.$/, @output);
+        fail "No $mode run with $threads threads reported.\n" if !defined $rate;
+        fail "No progress with $mode locks and $threads threads.\n" if $rate == 0;
+        fail "Blocking lock spun with $threads threads.\n" if $mode eq 'block' && $spun != 0;
+        fail "Adaptive lock never spun with $threads threads.\n"
+          if $mode eq 'adaptive' && $threads >= 2 && $spun == 0;
+    }
+}
+pass;
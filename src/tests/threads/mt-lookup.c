@@ -0,0 +1,56 @@
+/* Measures get_thread_by_tid(), the lookup process_execute()
+   does on every exec, with LOOKUP_THREADS threads alive and
+   blocked, and checks that it finds each of them. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/clock.h"
+
+/* Number of live threads. */
+#define LOOKUP_THREADS 2000
+
+/* Number of timed lookups. */
+#define LOOKUP_REPS 100000
+
+static void lookup_thread(void* go_) {
+  struct semaphore* go = go_;
+  sema_down(go);
+}
+
+void test_mt_lookup(void) {
+  static tid_t tids[LOOKUP_THREADS];
+  struct semaphore go;
+  uint64_t ns;
+  int i;
+
+  sema_init(&go, 0);
+  for (i = 0; i < LOOKUP_THREADS; i++) {
+    tids[i] = thread_create("lookup", PRI_DEFAULT, lookup_thread, &go);
+    if (tids[i] == TID_ERROR)
+      fail("creating thread %d failed", i);
+  }
+  thread_yield();
+  msg("%d threads created.", LOOKUP_THREADS);
+
+  for (i = 0; i < LOOKUP_THREADS; i++) {
+    struct thread* t = get_thread_by_tid(tids[i]);
+    if (t == NULL || t->tid != tids[i])
+      fail("lookup of tid %d failed", tids[i]);
+  }
+  if (get_thread_by_tid(tids[LOOKUP_THREADS - 1] + 1000000) != NULL)
+    fail("lookup of nonexistent tid succeeded");
+  msg("All lookups found the right thread.");
+
+  ns = clock_ns();
+  for (i = 0; i < LOOKUP_REPS; i++)
+    get_thread_by_tid(tids[i % LOOKUP_THREADS]);
+  ns = clock_ns() - ns;
+  msg("%d lookups: %lld ns each.", LOOKUP_REPS, (long long)(ns / LOOKUP_REPS));
+
+  for (i = 0; i < LOOKUP_THREADS; i++)
+    sema_up(&go);
+  thread_yield();
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings vary from run to run, so check only the format.
+fail "Threads not created.\n"
+  if !grep (/^\(mt-lookup\) 2000 threads created\.$/, @output);
+fail "Lookups failed.\n"
+  if !grep (/^\(mt-lookup\) All lookups found the right thread\.$/, @output);
+fail "No timing reported.\n"
+  if !grep (/^\(mt-lookup\) 100000 lookups: \d+ ns each\.$/, @output);
+pass;
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings vary from run to run, so check only that every run
+# reported a time and computed the right product.
+fail "Number of CPUs not reported.\n"
+  if !grep (/^\(mt-matmul-scale\) \d+ CPUs online\.$/, @output);
+foreach my $n (1, 2, 4) {
+    fail "No timing for $n threads.\n"
+      if !grep (/^\(mt-matmul-scale\) $n threads: \d+ us, speedup \d+\.\d\dx$/,
+		@output);
+}
+fail "Matrix results do not match expected values.\n"
+  if grep (/do not match/, @output);
+pass;
@@ -5,11 +5,14 @@
    https://github.com/ucb-bar/riscv-benchmarks/tree/master/mt-matmul */
 
 #include <stdio.h>
+#include <string.h>
 #include "tests/threads/tests.h"
 #include "tests/threads/matmul_data.h"
 #include "threads/init.h"
+#include "threads/smp.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "devices/clock.h"
 
 void __attribute__((noinline)) matmul(const int tid, const int nthreads, const int lda,
                                       const short A[], const short B[], short C[]);
@@ -83,3 +86,73 @@ void test_mt_matmul_16(void) {
   msg("Executing blocked matmul with 16 threads...");
   test_mt_matmul(16);
 }
+
+/* Number of times each mt-matmul-scale worker repeats its block,
+   so that each run takes long enough to time. */
+#define SCALE_REPS 200
+
+struct scale_args {
+  int tid;
+  int n_threads;
+  struct semaphore done; /* Upped when the worker finishes. */
+};
+
+/* mt-matmul-scale worker.  Recomputes its block of rows of the
+   result from scratch SCALE_REPS times. */
+static void scale_entry(void* aux) {
+  struct scale_args* args = aux;
+  int block = DIM_SIZE / args->n_threads;
+  short* rows = &results_data[block * args->tid * DIM_SIZE];
+  int rep;
+
+  for (rep = 0; rep < SCALE_REPS; rep++) {
+    memset(rows, 0, block * DIM_SIZE * sizeof *rows);
+    matmul(args->tid, args->n_threads, DIM_SIZE, input1_data, input2_data, results_data);
+  }
+  sema_up(&args->done);
+}
+
+/* Runs the blocked matmul with NUM_THREADS workers, joined with
+   semaphores rather than by priority so that it is correct with
+   any number of CPUs, and returns how long it took, in
+   nanoseconds. */
+static uint64_t time_scale_run(int num_threads) {
+  struct scale_args args[num_threads];
+  uint64_t start;
+  int i;
+
+  memset(results_data, 0, sizeof results_data);
+  start = clock_ns();
+  for (i = 0; i < num_threads; i++) {
+    args[i].tid = i;
+    args[i].n_threads = num_threads;
+    sema_init(&args[i].done, 0);
+    thread_create("matmul", PRI_DEFAULT, scale_entry, &args[i]);
+  }
+  for (i = 0; i < num_threads; i++)
+    sema_down(&args[i].done);
+  return clock_ns() - start;
+}
+
+/* Measures how the blocked matmul scales with the number of
+   CPUs.  Runs it with 1, 2, and 4 worker threads, which with 4
+   CPUs each get a CPU of their own, and reports each run's
+   speedup over the single-threaded run. */
+void test_mt_matmul_scale(void) {
+  uint64_t base_ns = 0;
+  int n;
+
+  msg("%d CPUs online.", cpu_cnt);
+  for (n = 1; n <= 4; n *= 2) {
+    uint64_t ns = time_scale_run(n);
+    int speedup;
+
+    if (n == 1)
+      base_ns = ns;
+    speedup = ns > 0 ? base_ns * 100 / ns : 0;
+    msg("%d threads: %lld us, speedup %d.%02dx", n, (long long)(ns / 1000), speedup / 100,
+        speedup % 100);
+    if (!verifyDouble(ARRAY_SIZE, results_data, verify_data))
+      msg("Matrix results do not match expected values with %d threads!", n);
+  }
+}
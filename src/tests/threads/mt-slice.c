@@ -0,0 +1,116 @@
+/* Measures the trade-off between throughput and latency made by
+   the length of time slices, first with fixed slices and then
+   with adaptive ones.
+
+   Each run pits a growing number of CPU-bound "hog" threads
+   against one interactive thread that sleeps for a tick at a
+   time, all at the same priority, for RUN_TICKS ticks.  The hogs'
+   total loop iterations per tick measure throughput; the time
+   the interactive thread spends ready but not running after each
+   wakeup measures latency, which is compared with the time each
+   hog spends ready between its turns to run. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Length of each run, in timer ticks. */
+#define RUN_TICKS TIMER_FREQ
+
+/* Largest number of hogs. */
+#define MAX_HOGS 16
+
+/* State shared by the threads of one run. */
+struct run {
+  volatile bool stop;       /* Set by the main thread to end the run. */
+  struct semaphore done;    /* Upped by each thread as it exits. */
+  long long iterations;     /* Total hog loop iterations. */
+  long long switches;       /* Total hog preemptions. */
+  long long hog_wait_ns;    /* Total time the hogs spent ready. */
+  long long wakeups;        /* Interactive thread wakeups. */
+  long long latency_ns;     /* Total latency of those wakeups. */
+  long long max_latency_ns; /* Largest latency of those wakeups. */
+};
+
+static void hog_thread(void* run_) {
+  struct run* run = run_;
+  struct thread* t = thread_current();
+  enum intr_level old_level;
+  long long iterations = 0;
+
+  while (!run->stop)
+    iterations++;
+
+  old_level = intr_disable();
+  run->iterations += iterations;
+  run->switches += t->involuntary_switches;
+  run->hog_wait_ns += t->ready_ns;
+  intr_set_level(old_level);
+  sema_up(&run->done);
+}
+
+static void interactive_thread(void* run_) {
+  struct run* run = run_;
+  struct thread* t = thread_current();
+
+  while (!run->stop) {
+    uint64_t ready_ns = t->ready_ns;
+    long long latency;
+
+    timer_sleep(1);
+    latency = t->ready_ns - ready_ns;
+    run->wakeups++;
+    run->latency_ns += latency;
+    if (latency > run->max_latency_ns)
+      run->max_latency_ns = latency;
+  }
+  sema_up(&run->done);
+}
+
+/* Runs HOGS hog threads against the interactive thread for
+   RUN_TICKS ticks with adaptive slices if ADAPTIVE is true, and
+   reports the results. */
+static void slice_run(bool adaptive, int hogs) {
+  struct run run;
+  int i;
+
+  run.stop = false;
+  sema_init(&run.done, 0);
+  run.iterations = run.switches = run.hog_wait_ns = 0;
+  run.wakeups = run.latency_ns = run.max_latency_ns = 0;
+
+  thread_adaptive_slice = adaptive;
+  for (i = 0; i < hogs; i++)
+    thread_create("hog", PRI_DEFAULT, hog_thread, &run);
+  thread_create("interactive", PRI_DEFAULT, interactive_thread, &run);
+  timer_sleep(RUN_TICKS);
+  run.stop = true;
+  for (i = 0; i < hogs + 1; i++)
+    sema_down(&run.done);
+
+  /* Each hog waited once to start and once after each time it
+     was preempted. */
+  msg("%s, %d hogs: %lld iterations/tick, %lld preemptions, "
+      "%lld wakeups, latency %lld us avg, %lld us max, hog wait %lld us avg.",
+      adaptive ? "adaptive" : "fixed", hogs, run.iterations / RUN_TICKS, run.switches,
+      run.wakeups, run.wakeups > 0 ? run.latency_ns / run.wakeups / 1000 : 0,
+      run.max_latency_ns / 1000, run.hog_wait_ns / (run.switches + hogs) / 1000);
+}
+
+void test_mt_slice(void) {
+  bool adaptive = thread_adaptive_slice;
+  int hogs;
+
+  /* The main thread must preempt the hogs to end each run. */
+  thread_set_priority(PRI_MAX);
+  for (hogs = 1; hogs <= MAX_HOGS; hogs *= 2) {
+    slice_run(false, hogs);
+    slice_run(true, hogs);
+  }
+  thread_adaptive_slice = adaptive;
+  thread_set_priority(PRI_DEFAULT);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings vary from run to run, so check that every run reported
+# and that the interactive thread ran in each.  With adaptive
+# slices and at least two hogs, a hog waits out at least one other
+# hog's slice between turns, while the woken interactive thread
+# goes to the front of the queue and waits for at most the rest
+# of the running hog's tick, so it must wait less on average.
+for my $hogs (1, 2, 4, 8, 16) {
+    for my $slice ("fixed", "adaptive") {
+        my ($wakeups, $latency, $hog_wait) = map (/^\(mt-slice\) $slice, $hogs hogs: \d+ iterations\/tick, \d+ preemptions, (\d+) wakeups, latency (\d+) us avg, \d+ us max, hog wait (\d+) us avg\.$/, @output);
+        fail "No $slice run with $hogs hogs reported.\n" if !defined $wakeups;
+        fail "Interactive thread never woke with $slice slices and $hogs hogs.\n"
+          if $wakeups == 0;
+        fail "Interactive thread waited $latency us on average, but hogs "
+          . "only $hog_wait us, with $slice slices and $hogs hogs.\n"
+          if $slice eq "adaptive" && $hogs >= 2 && $latency >= $hog_wait;
+    }
+}
+pass;
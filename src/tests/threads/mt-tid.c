@@ -0,0 +1,64 @@
+/* Has TID_CREATORS threads, spread across the CPUs, each create
+   TID_CHILDREN threads at once, and checks that every TID handed
+   out is positive and unique.  Each CPU hands out TIDs from a
+   batch of 16 and refills it from a shared counter, so the
+   creators use up and refill their CPUs' batches many times over,
+   often at the same moment. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of creating threads, and threads each one creates. */
+#define TID_CREATORS 4
+#define TID_CHILDREN 64
+
+/* TIDs returned to each creator by thread_create(). */
+static tid_t tids[TID_CREATORS][TID_CHILDREN];
+
+/* Upped by each creator when it is done. */
+static struct semaphore done;
+
+static void child_thread(void* aux UNUSED) {}
+
+static void creator_thread(void* tids_) {
+  tid_t* my_tids = tids_;
+  int i;
+
+  for (i = 0; i < TID_CHILDREN; i++)
+    my_tids[i] = thread_create("child", PRI_DEFAULT, child_thread, NULL);
+  sema_up(&done);
+}
+
+/* Compares the TIDs that A and B point to. */
+static int compare_tids(const void* a_, const void* b_) {
+  const tid_t* a = a_;
+  const tid_t* b = b_;
+
+  return *a < *b ? -1 : *a > *b;
+}
+
+void test_mt_tid(void) {
+  tid_t* all = &tids[0][0];
+  int cnt = TID_CREATORS * TID_CHILDREN;
+  int i;
+
+  sema_init(&done, 0);
+  for (i = 0; i < TID_CREATORS; i++)
+    thread_create("creator", PRI_DEFAULT, creator_thread, tids[i]);
+  for (i = 0; i < TID_CREATORS; i++)
+    sema_down(&done);
+  msg("%d creators made %d threads.", TID_CREATORS, cnt);
+
+  qsort(all, cnt, sizeof *all, compare_tids);
+  for (i = 0; i < cnt; i++) {
+    if (all[i] <= 0)
+      fail("thread_create() returned TID %d", all[i]);
+    if (i > 0 && all[i] == all[i - 1])
+      fail("TID %d handed out twice", all[i]);
+  }
+  msg("TIDs are positive and unique.");
+}
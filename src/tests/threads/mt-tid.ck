@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mt-tid) begin
+(mt-tid) 4 creators made 256 threads.
+(mt-tid) TIDs are positive and unique.
+(mt-tid) end
+EOF
+pass;
@@ -0,0 +1,54 @@
+/* Runs with the kernel option "-trace" and makes the scheduler
+   record each kind of event that pintos-trace2json decodes.  Two
+   CPU-bound threads share the CPU for SPIN_TICKS ticks each, so
+   the timer preempts them and every switch between them is
+   recorded, while a third thread sleeps SLEEPS times and is woken
+   up by the timer each time.  The checker feeds the trace dumped
+   at shutdown to pintos-trace2json and looks for thread runs,
+   wakeups, and preemptions in its output. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/sched-trace.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Ticks each CPU-bound thread runs for. */
+#define SPIN_TICKS 20
+
+/* Number of times the sleeping thread sleeps. */
+#define SLEEPS 10
+
+static void spin_thread(void* done_) {
+  struct semaphore* done = done_;
+  int64_t start = timer_ticks();
+
+  while (timer_elapsed(start) < SPIN_TICKS)
+    continue;
+  sema_up(done);
+}
+
+static void sleep_thread(void* done_) {
+  struct semaphore* done = done_;
+  int i;
+
+  for (i = 0; i < SLEEPS; i++)
+    timer_sleep(1);
+  sema_up(done);
+}
+
+void test_mt_trace(void) {
+  struct semaphore done;
+  int i;
+
+  ASSERT(sched_trace_enabled);
+
+  sema_init(&done, 0);
+  thread_create("spin 1", PRI_DEFAULT, spin_thread, &done);
+  thread_create("spin 2", PRI_DEFAULT, spin_thread, &done);
+  thread_create("sleeper", PRI_DEFAULT, sleep_thread, &done);
+  for (i = 0; i < 3; i++)
+    sema_down(&done);
+  msg("Threads finished.");
+}
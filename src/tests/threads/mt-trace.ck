@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@core) = get_core_output ("run", @output);
+fail "Threads did not finish.\n"
+  if !grep (/^\(mt-trace\) Threads finished\.$/, @core);
+
+# The trace is dumped at shutdown, after the core output.  Decode
+# it with pintos-trace2json, which is in the same source tree as
+# this checker.
+my ($srcdir) = $0 =~ m%^(.*)/tests/threads/[^/]+$%;
+fail "Can't find the source tree from $0.\n" if !defined $srcdir;
+open (my $decoder, '-|', 'perl', "$srcdir/utils/pintos-trace2json", "$test.output")
+  or fail "Can't run pintos-trace2json: $!\n";
+my ($json) = do { local $/; <$decoder> };
+close ($decoder) or fail "pintos-trace2json rejected the trace.\n";
+
+fail "No thread switches in the decoded trace.\n" if $json !~ /"cat":"run"/;
+fail "No wakeups in the decoded trace.\n" if $json !~ /"name":"unblock"/;
+fail "No preemptions in the decoded trace.\n" if $json !~ /"name":"preempt"/;
+pass;
@@ -0,0 +1,105 @@
+/* Measures how long a PRI_MAX thread waits for a lock held by a
+   PRI_MIN thread while several PRI_DEFAULT threads compete for
+   the CPU.
+
+   The main thread drops to PRI_MIN, acquires a lock, and starts
+   the medium threads, which spin for a long time once released.
+   Then a PRI_MAX thread tries to acquire the lock.  With
+   priority donation the main thread inherits PRI_MAX, finishes
+   its short critical section without being preempted by the
+   medium threads, and hands over the lock, so the high-priority
+   thread waits only about as long as the critical section.
+   Without donation it would also wait for every medium thread to
+   finish spinning. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of medium-priority threads competing for the CPU. */
+#define MEDIUM_CNT 4
+
+/* Length of the low-priority thread's critical section, in
+   ticks. */
+#define CRITICAL_TICKS 10
+
+/* How long each medium-priority thread spins, in ticks. */
+#define SPIN_TICKS 50
+
+struct latency_test {
+  struct lock lock;           /* Lock held by the low-priority thread. */
+  struct semaphore go_sema;   /* Releases the medium threads. */
+  struct semaphore done_sema; /* Signaled by each finished thread. */
+  int64_t wait_ticks;         /* Time the high thread waited for LOCK. */
+};
+
+static thread_func medium_thread_func;
+static thread_func high_thread_func;
+static void spin(int64_t ticks);
+
+void test_priority_donate_latency(void) {
+  struct latency_test test;
+  int i;
+
+  ASSERT(active_sched_policy == SCHED_PRIO);
+
+  lock_init(&test.lock);
+  sema_init(&test.go_sema, 0);
+  sema_init(&test.done_sema, 0);
+
+  thread_set_priority(PRI_MIN);
+  lock_acquire(&test.lock);
+
+  /* Each medium thread preempts us and blocks on GO_SEMA. */
+  for (i = 0; i < MEDIUM_CNT; i++)
+    thread_create("medium", PRI_DEFAULT, medium_thread_func, &test);
+
+  /* The high thread preempts us, blocks on LOCK, and donates. */
+  thread_create("high", PRI_MAX, high_thread_func, &test);
+  msg("Low thread running at priority %d with the lock held.", thread_get_priority());
+
+  /* Make the medium threads ready, then run the critical
+     section. */
+  for (i = 0; i < MEDIUM_CNT; i++)
+    sema_up(&test.go_sema);
+  spin(CRITICAL_TICKS);
+  lock_release(&test.lock);
+
+  for (i = 0; i < MEDIUM_CNT + 1; i++)
+    sema_down(&test.done_sema);
+
+  msg("High thread waited %" PRId64 " ticks for a %d-tick critical section.", test.wait_ticks,
+      CRITICAL_TICKS);
+  if (test.wait_ticks > CRITICAL_TICKS + 2)
+    fail("high thread was delayed by medium-priority threads");
+}
+
+static void medium_thread_func(void* test_) {
+  struct latency_test* test = test_;
+
+  sema_down(&test->go_sema);
+  spin(SPIN_TICKS);
+  sema_up(&test->done_sema);
+}
+
+static void high_thread_func(void* test_) {
+  struct latency_test* test = test_;
+  int64_t start = timer_ticks();
+
+  lock_acquire(&test->lock);
+  test->wait_ticks = timer_elapsed(start);
+  lock_release(&test->lock);
+  sema_up(&test->done_sema);
+}
+
+/* Busy-waits for TICKS timer ticks without sleeping. */
+static void spin(int64_t ticks) {
+  int64_t start = timer_ticks();
+
+  while (timer_elapsed(start) < ticks)
+    continue;
+}
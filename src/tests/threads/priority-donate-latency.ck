@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+fail "Low thread did not inherit PRI_MAX.\n"
+  if !grep (/Low thread running at priority 63 with the lock held\./, @output);
+my ($wait, $critical);
+foreach (@output) {
+    ($wait, $critical) = /High thread waited (\d+) ticks for a (\d+)-tick/ and last;
+}
+fail "Wait time missing from output.\n" if !defined $wait;
+fail "High thread waited $wait ticks for a $critical-tick critical section.\n"
+  if $wait > $critical + 2;
+pass;
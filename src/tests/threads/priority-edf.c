@@ -0,0 +1,127 @@
+/* Checks that earliest-deadline-first real-time threads meet all
+   of their deadlines when their reservations add up to 90% of the
+   CPU, even with a CPU-bound thread running at PRI_MAX.
+
+   Three real-time threads reserve 3 ticks in every 10, 6 in every
+   20, and 15 in every 50.  In each period, each one spins until it
+   has seen one tick less than its budget go by while it was
+   running, so it never runs out of budget, and then waits for its
+   next period.  Along the way the test checks that admission
+   control rejects a reservation that would take the total above
+   100% but accepts one that brings it to exactly 100%. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of real-time threads. */
+#define RT_CNT 3
+
+/* Length of the measurement, in ticks. */
+#define MEASURE_TICKS (5 * TIMER_FREQ)
+
+struct rt_info {
+  int64_t period;        /* Period, in ticks. */
+  int64_t budget;        /* Budget per period, in ticks. */
+  int64_t end_time;      /* When to stop. */
+  int job_cnt;           /* Number of periods' work completed. */
+  int miss_cnt;          /* Number of deadlines missed. */
+  struct semaphore done; /* Upped when the thread finishes. */
+};
+
+static thread_func rt_thread;
+static thread_func background_thread;
+
+static struct semaphore admitted;
+
+void test_priority_edf(void) {
+  static const int64_t periods[RT_CNT] = {10, 20, 50};
+  static const int64_t budgets[RT_CNT] = {3, 6, 15};
+  struct rt_info info[RT_CNT];
+  int64_t end_time;
+  int i;
+
+  ASSERT(active_sched_policy == SCHED_PRIO);
+
+  end_time = timer_ticks() + MEASURE_TICKS;
+  sema_init(&admitted, 0);
+  for (i = 0; i < RT_CNT; i++) {
+    info[i].period = periods[i];
+    info[i].budget = budgets[i];
+    info[i].end_time = end_time;
+    info[i].job_cnt = 0;
+    info[i].miss_cnt = 0;
+    sema_init(&info[i].done, 0);
+    thread_create("rt", PRI_MIN, rt_thread, &info[i]);
+  }
+  for (i = 0; i < RT_CNT; i++)
+    sema_down(&admitted);
+  msg("Admitted %d real-time threads at 90%% utilization.", RT_CNT);
+
+  if (thread_set_realtime(10, 2))
+    fail("admitted a thread that raises utilization to 110%%");
+  msg("Rejected a thread that would raise utilization to 110%%.");
+  if (!thread_set_realtime(100, 10))
+    fail("rejected a thread that raises utilization to exactly 100%%");
+  thread_clear_realtime();
+  msg("Admitted a thread that raises utilization to exactly 100%%.");
+
+  msg("Running with a CPU-bound thread at PRI_MAX, please wait...");
+  thread_create("background", PRI_MAX, background_thread, &end_time);
+  for (i = 0; i < RT_CNT; i++)
+    sema_down(&info[i].done);
+
+  for (i = 0; i < RT_CNT; i++) {
+    struct rt_info* rt = &info[i];
+    if (rt->miss_cnt != 0)
+      fail("thread with period %lld and budget %lld missed %d of %d deadlines",
+           (long long)rt->period, (long long)rt->budget, rt->miss_cnt, rt->job_cnt);
+    if (rt->job_cnt < MEASURE_TICKS / rt->period - 2)
+      fail("thread with period %lld completed only %d periods' work", (long long)rt->period,
+           rt->job_cnt);
+    msg("Thread with period %lld and budget %lld missed no deadlines.", (long long)rt->period,
+        (long long)rt->budget);
+  }
+}
+
+/* Admits itself as a real-time thread and does one tick less than
+   its budget of work in each period until the end time. */
+static void rt_thread(void* info_) {
+  struct rt_info* info = info_;
+
+  if (!thread_set_realtime(info->period, info->budget))
+    fail("thread with period %lld and budget %lld was not admitted", (long long)info->period,
+         (long long)info->budget);
+  sema_up(&admitted);
+
+  while (timer_ticks() < info->end_time) {
+    int64_t last_time = timer_ticks();
+    int work = 0;
+
+    /* Every tick charged against the budget is seen here, so this
+       uses at most BUDGET - 1 ticks of it. */
+    while (work < info->budget - 1) {
+      int64_t cur_time = timer_ticks();
+      if (cur_time != last_time)
+        work++;
+      last_time = cur_time;
+    }
+    info->job_cnt++;
+    thread_wait_period();
+  }
+  info->miss_cnt = thread_get_deadline_misses();
+  thread_clear_realtime();
+  sema_up(&info->done);
+}
+
+/* Spins until the end time, competing with the real-time
+   threads. */
+static void background_thread(void* end_time_) {
+  int64_t* end_time = end_time_;
+
+  while (timer_ticks() < *end_time)
+    continue;
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-edf) begin
+(priority-edf) Admitted 3 real-time threads at 90% utilization.
+(priority-edf) Rejected a thread that would raise utilization to 110%.
+(priority-edf) Admitted a thread that raises utilization to exactly 100%.
+(priority-edf) Running with a CPU-bound thread at PRI_MAX, please wait...
+(priority-edf) Thread with period 10 and budget 3 missed no deadlines.
+(priority-edf) Thread with period 20 and budget 6 missed no deadlines.
+(priority-edf) Thread with period 50 and budget 15 missed no deadlines.
+(priority-edf) end
+EOF
+pass;
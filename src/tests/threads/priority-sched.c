@@ -0,0 +1,78 @@
+/* Measures the cost of schedule() under the strict-priority
+   scheduler as the number of ready threads grows.
+
+   The main thread runs at PRI_MAX and yields in a tight loop for
+   a fixed number of ticks while N lower-priority threads sit in
+   the ready queues.  Each yield enqueues the main thread and asks
+   the scheduler for the next thread to run, which is the main
+   thread again, so the number of yields per tick is a direct
+   measure of the enqueue and pick-next cost.  The rate should be
+   essentially independent of N. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of timer ticks to spend yielding for each measurement. */
+#define MEASURE_TICKS 50
+
+static int measure(int thread_cnt);
+static thread_func ready_thread;
+
+/* Signaled by each ready thread once it finally gets to run. */
+static struct semaphore done_sema;
+
+void test_priority_sched(void) {
+  static const int thread_cnts[] = {10, 100, 1000};
+  int rates[3];
+  size_t i;
+
+  ASSERT(active_sched_policy == SCHED_PRIO);
+
+  thread_set_priority(PRI_MAX);
+  for (i = 0; i < 3; i++) {
+    rates[i] = measure(thread_cnts[i]);
+    msg("%d ready threads: %d yields per tick.", thread_cnts[i], rates[i]);
+  }
+
+  if (rates[2] * 2 < rates[0])
+    fail("schedule() slowed down by more than half with %d ready threads", thread_cnts[2]);
+  msg("schedule() cost is flat.");
+}
+
+/* Returns the number of thread_yield() calls per timer tick that
+   the main thread achieves with THREAD_CNT ready threads of lower
+   priority. */
+static int measure(int thread_cnt) {
+  int64_t start;
+  int yields = 0;
+  int i;
+
+  sema_init(&done_sema, 0);
+  for (i = 0; i < thread_cnt; i++)
+    if (thread_create("ready", PRI_MIN + i % (PRI_MAX - PRI_MIN), ready_thread, NULL)
+        == TID_ERROR)
+      fail("couldn't create thread %d", i);
+
+  /* Start on a tick boundary. */
+  start = timer_ticks();
+  while (timer_ticks() == start)
+    continue;
+
+  start = timer_ticks();
+  while (timer_elapsed(start) < MEASURE_TICKS) {
+    thread_yield();
+    yields++;
+  }
+
+  /* Let the ready threads run and exit. */
+  for (i = 0; i < thread_cnt; i++)
+    sema_down(&done_sema);
+
+  return yields / MEASURE_TICKS;
+}
+
+static void ready_thread(void* aux UNUSED) { sema_up(&done_sema); }
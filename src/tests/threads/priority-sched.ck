@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+foreach my $n (10, 100, 1000) {
+    fail "Missing measurement with $n ready threads.\n"
+      if !grep (/\($test\) $n ready threads: \d+ yields per tick\./, @output);
+}
+fail "schedule() cost did not stay flat.\n"
+  if !grep (/schedule\(\) cost is flat\./, @output);
+pass;
@@ -0,0 +1,114 @@
+/* Measures how closely the fair scheduler divides the CPU among
+   CPU-bound threads of different priorities while an interactive
+   thread keeps sleeping and waking up.
+
+   Three CPU-bound threads run at priorities PRI_DEFAULT - 8,
+   PRI_DEFAULT, and PRI_DEFAULT + 8, whose weights are in the
+   ratio 1:2:4, so over 10 seconds they should receive about 1/7,
+   2/7, and 4/7 of the ticks the interactive thread leaves over.
+   The interactive thread runs at PRI_MIN, sleeps for a tick at a
+   time, and must still be scheduled promptly every time it
+   wakes up.  The checker compares each share against its
+   weight. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of CPU-bound threads. */
+#define LOAD_CNT 3
+
+/* Length of the measurement, in ticks. */
+#define MEASURE_TICKS (10 * TIMER_FREQ)
+
+/* Worst acceptable delay between an interactive thread's wakeup
+   and the time it gets to run, in ticks. */
+#define MAX_WAKE_LATENCY 1
+
+struct thread_info {
+  int64_t start_time;    /* When to start measuring. */
+  int tick_count;        /* Ticks observed while running. */
+  int wake_cnt;          /* Interactive thread: number of wakeups. */
+  int64_t max_latency;   /* Interactive thread: worst wakeup delay. */
+  struct semaphore done; /* Upped when the thread finishes. */
+};
+
+static thread_func load_thread;
+static thread_func interactive_thread;
+
+void test_smfs_share(void) {
+  static const int priorities[LOAD_CNT] = {PRI_DEFAULT - 8, PRI_DEFAULT, PRI_DEFAULT + 8};
+  struct thread_info info[LOAD_CNT + 1];
+  int64_t start_time;
+  int i;
+
+  ASSERT(active_sched_policy == SCHED_FAIR);
+
+  /* Give the threads a second to get going before measuring. */
+  start_time = timer_ticks() + TIMER_FREQ;
+  for (i = 0; i <= LOAD_CNT; i++) {
+    info[i].start_time = start_time;
+    info[i].tick_count = 0;
+    info[i].wake_cnt = 0;
+    info[i].max_latency = 0;
+    sema_init(&info[i].done, 0);
+  }
+
+  for (i = 0; i < LOAD_CNT; i++) {
+    char name[16];
+    snprintf(name, sizeof name, "load %d", i);
+    thread_create(name, priorities[i], load_thread, &info[i]);
+  }
+  thread_create("interactive", PRI_MIN, interactive_thread, &info[LOAD_CNT]);
+
+  msg("Sleeping 11 seconds to let threads run, please wait...");
+  for (i = 0; i <= LOAD_CNT; i++)
+    sema_down(&info[i].done);
+
+  for (i = 0; i < LOAD_CNT; i++)
+    msg("Thread at priority %d received %d ticks.", priorities[i], info[i].tick_count);
+  msg("Interactive thread woke up %d times.", info[LOAD_CNT].wake_cnt);
+  if (info[LOAD_CNT].max_latency > MAX_WAKE_LATENCY)
+    fail("interactive thread waited %" PRId64 " ticks to run after waking up",
+         info[LOAD_CNT].max_latency);
+}
+
+/* Spins until the end of the measurement, counting the ticks
+   during which it was running. */
+static void load_thread(void* info_) {
+  struct thread_info* info = info_;
+  int64_t last_time = 0;
+
+  while (timer_ticks() < info->start_time)
+    continue;
+  while (timer_elapsed(info->start_time) < MEASURE_TICKS) {
+    int64_t cur_time = timer_ticks();
+    if (cur_time != last_time)
+      info->tick_count++;
+    last_time = cur_time;
+  }
+  sema_up(&info->done);
+}
+
+/* Repeatedly sleeps for one tick and records how late it was
+   scheduled after each wakeup. */
+static void interactive_thread(void* info_) {
+  struct thread_info* info = info_;
+
+  timer_sleep(info->start_time - timer_ticks());
+  while (timer_elapsed(info->start_time) < MEASURE_TICKS) {
+    int64_t wake_time = timer_ticks() + 1;
+    int64_t latency;
+
+    timer_sleep(1);
+    latency = timer_ticks() - wake_time;
+    if (latency > info->max_latency)
+      info->max_latency = latency;
+    info->wake_cnt++;
+  }
+  sema_up(&info->done);
+}
@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Weights double every 8 priority levels.
+my (%weight) = (23 => 1, 31 => 2, 39 => 4);
+my (%ticks);
+foreach (@output) {
+    $ticks{$1} = $2 if /Thread at priority (\d+) received (\d+) ticks\./;
+}
+fail "Missing tick counts.\n" if keys (%ticks) != keys (%weight);
+
+my ($total_ticks) = 0;
+$total_ticks += $_ foreach values (%ticks);
+my ($total_weight) = 0;
+$total_weight += $_ foreach values (%weight);
+fail "CPU-bound threads received only $total_ticks ticks.\n"
+  if $total_ticks < 800;
+
+# Each thread's share must be within 10% of its weight.
+foreach my $pri (sort { $a <=> $b } keys (%weight)) {
+    my ($expected) = $total_ticks * $weight{$pri} / $total_weight;
+    my ($diff) = abs ($ticks{$pri} - $expected);
+    fail sprintf ("Thread at priority %d received %d ticks, "
+		  . "expected %.0f +/- 10%%.\n",
+		  $pri, $ticks{$pri}, $expected)
+      if $diff > $expected / 10;
+}
+pass;
@@ -0,0 +1,165 @@
+/* Checks that the stride scheduler divides the CPU in proportion
+   to tickets.
+
+   The stride-fair tests run 2 or 20 threads with equal tickets,
+   which should all receive the same number of ticks.  The
+   stride-ratio tests run threads with 100, 200, and so on
+   tickets, which should receive ticks in proportion.  Each test
+   spins for 30 seconds, so the ticks should sum to about
+   30 * 100 == 3000, and the .ck files require each thread to be
+   within 2% of its exact share.
+
+   stride-transfer checks ticket transfer through locks: a
+   100-ticket thread holding a lock that a 400-ticket thread is
+   waiting for competes with a 100-ticket thread, so it should get
+   500 / 600 of the CPU until it releases the lock. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void test_stride_shares(int thread_cnt, int tickets_min, int tickets_step);
+
+void test_stride_fair_2(void) { test_stride_shares(2, 100, 0); }
+
+void test_stride_fair_20(void) { test_stride_shares(20, 100, 0); }
+
+void test_stride_ratio_3(void) { test_stride_shares(3, 100, 100); }
+
+void test_stride_ratio_4(void) { test_stride_shares(4, 100, 100); }
+
+#define MAX_THREAD_CNT 20
+
+struct thread_info {
+  int64_t start_time;
+  int tick_count;
+  int tickets;
+};
+
+static void load_thread(void* aux);
+
+static void test_stride_shares(int thread_cnt, int tickets_min, int tickets_step) {
+  struct thread_info info[MAX_THREAD_CNT];
+  int64_t start_time;
+  int i;
+
+  ASSERT(active_sched_policy == SCHED_STRIDE);
+  ASSERT(thread_cnt <= MAX_THREAD_CNT);
+
+  start_time = timer_ticks();
+  msg("Starting %d threads...", thread_cnt);
+  for (i = 0; i < thread_cnt; i++) {
+    struct thread_info* ti = &info[i];
+    char name[16];
+
+    ti->start_time = start_time;
+    ti->tick_count = 0;
+    ti->tickets = tickets_min + i * tickets_step;
+
+    snprintf(name, sizeof name, "load %d", i);
+    thread_create(name, PRI_DEFAULT, load_thread, ti);
+  }
+  msg("Starting threads took %" PRId64 " ticks.", timer_elapsed(start_time));
+
+  msg("Sleeping 40 seconds to let threads run, please wait...");
+  timer_sleep(40 * TIMER_FREQ);
+
+  for (i = 0; i < thread_cnt; i++)
+    msg("Thread %d received %d ticks.", i, info[i].tick_count);
+}
+
+static void load_thread(void* ti_) {
+  struct thread_info* ti = ti_;
+  int64_t sleep_time = 5 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 30 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  thread_set_tickets(ti->tickets);
+  timer_sleep(sleep_time - timer_elapsed(ti->start_time));
+  while (timer_elapsed(ti->start_time) < spin_time) {
+    int64_t cur_time = timer_ticks();
+    if (cur_time != last_time)
+      ti->tick_count++;
+    last_time = cur_time;
+  }
+}
+
+/* stride-transfer. */
+
+#define HOLD_TICKS 500 /* Ticks the holder runs with the lock held. */
+
+struct transfer_info {
+  int64_t start_time;
+  struct lock lock;
+  volatile bool released;
+  int holder_ticks;
+  int competitor_ticks;
+};
+
+/* Takes the lock, then spins for HOLD_TICKS ticks of its own CPU
+   time, starting 1 second in, and releases it. */
+static void holder_thread(void* ti_) {
+  struct transfer_info* ti = ti_;
+  int64_t last_time = 0;
+
+  lock_acquire(&ti->lock);
+  timer_sleep(TIMER_FREQ - timer_elapsed(ti->start_time));
+  while (ti->holder_ticks < HOLD_TICKS) {
+    int64_t cur_time = timer_ticks();
+    if (cur_time != last_time)
+      ti->holder_ticks++;
+    last_time = cur_time;
+  }
+  ti->released = true;
+  lock_release(&ti->lock);
+}
+
+/* Waits for the lock, transferring its 400 tickets to the
+   holder. */
+static void waiter_thread(void* ti_) {
+  struct transfer_info* ti = ti_;
+
+  thread_set_tickets(400);
+  timer_sleep(TIMER_FREQ / 2 - timer_elapsed(ti->start_time));
+  lock_acquire(&ti->lock);
+  lock_release(&ti->lock);
+}
+
+/* Spins from 1 second in until the holder releases the lock. */
+static void competitor_thread(void* ti_) {
+  struct transfer_info* ti = ti_;
+  int64_t last_time = 0;
+
+  timer_sleep(TIMER_FREQ - timer_elapsed(ti->start_time));
+  while (!ti->released) {
+    int64_t cur_time = timer_ticks();
+    if (cur_time != last_time)
+      ti->competitor_ticks++;
+    last_time = cur_time;
+  }
+}
+
+void test_stride_transfer(void) {
+  struct transfer_info ti;
+
+  ASSERT(active_sched_policy == SCHED_STRIDE);
+
+  ti.start_time = timer_ticks();
+  lock_init(&ti.lock);
+  ti.released = false;
+  ti.holder_ticks = ti.competitor_ticks = 0;
+
+  thread_create("holder", PRI_DEFAULT, holder_thread, &ti);
+  thread_create("waiter", PRI_DEFAULT, waiter_thread, &ti);
+  thread_create("competitor", PRI_DEFAULT, competitor_thread, &ti);
+
+  msg("Sleeping 10 seconds to let threads run, please wait...");
+  timer_sleep(10 * TIMER_FREQ);
+
+  msg("Holder received %d ticks.", ti.holder_ticks);
+  msg("Competitor received %d ticks.", ti.competitor_ticks);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# With the waiter's 400 tickets transferred to it, the holder has
+# 500 tickets against the competitor's 100, so it should receive
+# 5/6 of the CPU while it holds the lock.
+my ($holder) = map (/^\(stride-transfer\) Holder received (\d+) ticks\.$/, @output);
+my ($competitor) = map (/^\(stride-transfer\) Competitor received (\d+) ticks\.$/, @output);
+fail "Tick counts missing.\n" if !defined ($holder) || !defined ($competitor);
+my ($share) = $holder / ($holder + $competitor);
+fail sprintf ("Holder received %.1f%% of the CPU, not 83.3%%.  "
+	      . "Were the waiter's tickets transferred?\n", $share * 100)
+  if abs ($share - 5 / 6) > .02 * 5 / 6;
+pass;
@@ -0,0 +1,48 @@
+# -*- perl -*-
+use strict;
+use warnings;
+
+# Checks that the threads in a stride-fair or stride-ratio test
+# received ticks in proportion to TICKETS, each within 2% of its
+# share of the total.
+sub check_stride_shares {
+    my ($tickets) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my (@actual);
+    local ($_);
+    foreach (@output) {
+	my ($id, $count) = /Thread (\d+) received (\d+) ticks\./ or next;
+	$actual[$id] = $count;
+    }
+    fail "Some tick counts were missing.\n"
+      if grep (!defined, @actual[0...$#$tickets]);
+
+    my ($total_ticks) = 0;
+    $total_ticks += $_ foreach @actual;
+    my ($total_tickets) = 0;
+    $total_tickets += $_ foreach @$tickets;
+
+    my ($ok) = 1;
+    my (@rows);
+    for my $i (0...$#$tickets) {
+	my ($expected) = $total_ticks * $tickets->[$i] / $total_tickets;
+	my ($bad) = abs ($actual[$i] - $expected) > .02 * $expected;
+	$ok = 0 if $bad;
+	push (@rows, sprintf ("%6d %8d %8d %8.1f %s", $i, $tickets->[$i],
+			      $actual[$i], $expected, $bad ? "<<< off by more than 2%" : ""));
+    }
+    if (!$ok) {
+	print "Some threads' shares of the CPU differed from their share of "
+	  . "the tickets by more than 2%.\n";
+	print "thread  tickets   actual expected\n";
+	print "$_\n" foreach @rows;
+	fail;
+    }
+    pass;
+}
+
+1;
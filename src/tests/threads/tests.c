@@ -10,6 +10,13 @@ static const struct test threads_tests[] = {
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-idle-10", test_alarm_idle_10},
+    {"alarm-idle-100", test_alarm_idle_100},
+    {"alarm-idle-500", test_alarm_idle_500},
+    {"alarm-tickless", test_alarm_tickless},
+    {"alarm-hires", test_alarm_hires},
+    {"alarm-boot-lpt", test_alarm_boot_lpt},
+    {"alarm-accounting", test_alarm_accounting},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -18,16 +25,29 @@ static const struct test threads_tests[] = {
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-latency", test_priority_donate_latency},
+    {"priority-edf", test_priority_edf},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
     {"priority-starve", test_priority_starve},
     {"priority-starve-sema", test_priority_starve_sema},
+    {"priority-sched", test_priority_sched},
     {"st-matmul", test_mt_matmul_1},
     {"mt-matmul-2", test_mt_matmul_2},
     {"mt-matmul-4", test_mt_matmul_4},
     {"mt-matmul-16", test_mt_matmul_16},
+    {"mt-matmul-scale", test_mt_matmul_scale},
+    {"mt-balance", test_mt_balance},
+    {"mt-churn", test_mt_churn},
+    {"mt-lookup", test_mt_lookup},
+    {"mt-slice", test_mt_slice},
+    {"mt-defer", test_mt_defer},
+    {"mt-lock", test_mt_lock},
+    {"mt-condvar", test_mt_condvar},
+    {"mt-tid", test_mt_tid},
+    {"mt-trace", test_mt_trace},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -37,6 +57,12 @@ static const struct test threads_tests[] = {
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-tick-cost", test_mlfqs_tick_cost},
+    {"stride-fair-2", test_stride_fair_2},
+    {"stride-fair-20", test_stride_fair_20},
+    {"stride-ratio-3", test_stride_ratio_3},
+    {"stride-ratio-4", test_stride_ratio_4},
+    {"stride-transfer", test_stride_transfer},
     {"smfs-starve-0", test_smfs_starve_0},
     {"smfs-starve-1", test_smfs_starve_1},
     {"smfs-starve-2", test_smfs_starve_2},
@@ -50,7 +76,8 @@ static const struct test threads_tests[] = {
     {"smfs-hierarchy-16", test_smfs_hierarchy_16},
     {"smfs-hierarchy-32", test_smfs_hierarchy_32},
     {"smfs-hierarchy-64", test_smfs_hierarchy_64},
-    {"smfs-hierarchy-256", test_smfs_hierarchy_256}};
+    {"smfs-hierarchy-256", test_smfs_hierarchy_256},
+    {"smfs-share", test_smfs_share}};
 
 /* Runs the threads test named NAME. */
 void run_threads_test(const char* name) {
@@ -11,6 +11,13 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_idle_10;
+extern test_func test_alarm_idle_100;
+extern test_func test_alarm_idle_500;
+extern test_func test_alarm_tickless;
+extern test_func test_alarm_hires;
+extern test_func test_alarm_boot_lpt;
+extern test_func test_alarm_accounting;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -19,16 +26,29 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_latency;
+extern test_func test_priority_edf;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
 extern test_func test_priority_starve;
 extern test_func test_priority_starve_sema;
+extern test_func test_priority_sched;
 extern test_func test_mt_matmul_1;
 extern test_func test_mt_matmul_2;
 extern test_func test_mt_matmul_4;
 extern test_func test_mt_matmul_16;
+extern test_func test_mt_matmul_scale;
+extern test_func test_mt_balance;
+extern test_func test_mt_churn;
+extern test_func test_mt_lookup;
+extern test_func test_mt_slice;
+extern test_func test_mt_defer;
+extern test_func test_mt_lock;
+extern test_func test_mt_condvar;
+extern test_func test_mt_tid;
+extern test_func test_mt_trace;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -38,6 +58,12 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_tick_cost;
+extern test_func test_stride_fair_2;
+extern test_func test_stride_fair_20;
+extern test_func test_stride_ratio_3;
+extern test_func test_stride_ratio_4;
+extern test_func test_stride_transfer;
 extern test_func test_smfs_starve_0;
 extern test_func test_smfs_starve_1;
 extern test_func test_smfs_starve_2;
@@ -52,5 +78,6 @@ extern test_func test_smfs_hierarchy_16;
 extern test_func test_smfs_hierarchy_32;
 extern test_func test_smfs_hierarchy_64;
 extern test_func test_smfs_hierarchy_256;
+extern test_func test_smfs_share;
 
 #endif /* tests/threads/tests.h */
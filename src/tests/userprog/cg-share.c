@@ -0,0 +1,49 @@
+/* Puts one child process in a CPU group with a quota of 30 ticks
+   per 100 and another in a group with 70 per 100, and checks
+   that, while both are busy, the groups split the CPU 30/70, to
+   within 2% of the total. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Starts child-cg in GROUP, spinning until the group has used
+   TICKS ticks. */
+static pid_t spawn(int group, int ticks) {
+  char cmd[64];
+  pid_t pid;
+
+  CHECK(cg_join(group), "join group");
+  snprintf(cmd, sizeof cmd, "child-cg %d %d", group, ticks);
+  pid = exec(cmd);
+  if (pid == -1)
+    fail("exec(\"%s\") failed", cmd);
+  return pid;
+}
+
+void test_main(void) {
+  int a, b, used_a, used_b, share;
+  pid_t pid_a, pid_b;
+
+  CHECK((a = cg_create()) > 0, "create group a");
+  CHECK((b = cg_create()) > 0, "create group b");
+  CHECK(cg_set_quota(a, 30, 100), "limit group a to 30%%");
+  CHECK(cg_set_quota(b, 70, 100), "limit group b to 70%%");
+
+  /* Group a's child wants more CPU time than group b's, so it is
+     still busy when group b's finishes. */
+  pid_a = spawn(a, 450);
+  pid_b = spawn(b, 700);
+  CHECK(cg_join(0), "leave groups");
+
+  wait(pid_b);
+  used_a = cg_usage(a);
+  used_b = cg_usage(b);
+  share = used_a * 1000 / (used_a + used_b);
+  if (share < 280 || share > 320)
+    fail("group a used %d ticks and group b %d, a %d.%d%% share", used_a, used_b, share / 10,
+         share % 10);
+  msg("shares within 2%% of 30/70");
+  wait(pid_a);
+}
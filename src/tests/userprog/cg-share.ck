@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cg-share) begin
+(cg-share) create group a
+(cg-share) create group b
+(cg-share) limit group a to 30%
+(cg-share) limit group b to 70%
+(cg-share) join group
+(cg-share) join group
+(cg-share) leave groups
+child-cg: exit(0)
+(cg-share) shares within 2% of 30/70
+child-cg: exit(0)
+(cg-share) end
+cg-share: exit(0)
+EOF
+pass;
@@ -0,0 +1,17 @@
+/* Child process run by cg-share.
+   Spins until CPU group argv[1] has used argv[2] ticks. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+int main(int argc UNUSED, char* argv[]) {
+  int group = atoi(argv[1]);
+  int ticks = atoi(argv[2]);
+
+  test_name = "child-cg";
+
+  while (cg_usage(group) < ticks)
+    continue;
+  return 0;
+}
@@ -0,0 +1,105 @@
+/* Measures the throughput of filesys_open() with a growing number
+   of threads opening and closing the same file at once.
+
+   The main thread keeps the file and the root directory open
+   throughout, so every open finds their inodes in the open inode
+   table, whose lookups take no lock, and must get back the same
+   `struct inode', with its single open count, as the main
+   thread's.  Opens still read the root directory from disk, which
+   serializes them on the disk controller, so throughput is
+   bounded by the disk. */
+
+#include <stdio.h>
+#include <atomic.h>
+#include "tests/userprog/kernel/tests.h"
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Length of each run, in timer ticks. */
+#define RUN_TICKS TIMER_FREQ
+
+/* Largest number of threads. */
+#define MAX_THREADS 8
+
+/* State shared by the threads of one run. */
+struct run {
+  volatile bool stop;    /* Set by the main thread to end the run. */
+  struct semaphore done; /* Upped by each thread as it exits. */
+  struct inode* inode;   /* The file's inode, opened by the main thread. */
+  int opens;             /* Total opens, updated atomically. */
+  bool failed;           /* Did an open fail? */
+  bool duplicated;       /* Did an open get a second inode? */
+};
+
+static void open_thread(void* run_) {
+  struct run* run = run_;
+  int opens = 0;
+
+  while (!run->stop) {
+    struct file* file = filesys_open("fs-open");
+
+    if (file == NULL) {
+      run->failed = true;
+      break;
+    }
+    if (file_get_inode(file) != run->inode)
+      run->duplicated = true;
+    file_close(file);
+    opens++;
+  }
+  atomic_fetch_add(&run->opens, opens);
+  sema_up(&run->done);
+}
+
+/* Runs THREADS threads opening the file for RUN_TICKS ticks and
+   reports the results. */
+static void open_run(struct inode* inode, int threads) {
+  struct run run;
+  int i;
+
+  run.stop = false;
+  sema_init(&run.done, 0);
+  run.inode = inode;
+  run.opens = 0;
+  run.failed = false;
+  run.duplicated = false;
+
+  for (i = 0; i < threads; i++)
+    thread_create("opener", PRI_DEFAULT, open_thread, &run);
+  timer_sleep(RUN_TICKS);
+  run.stop = true;
+  for (i = 0; i < threads; i++)
+    sema_down(&run.done);
+
+  if (run.failed)
+    fail("filesys_open() failed with %d threads", threads);
+  if (run.duplicated)
+    fail("filesys_open() returned a second inode with %d threads", threads);
+  msg("%d threads: %d opens/tick.", threads, run.opens / RUN_TICKS);
+}
+
+void test_fs_open(void) {
+  struct dir* root;
+  struct file* file;
+  int threads;
+
+  if (!filesys_create("fs-open", 0))
+    fail("couldn't create file");
+  file = filesys_open("fs-open");
+  root = dir_open_root();
+  if (file == NULL || root == NULL)
+    fail("couldn't open file and root directory");
+
+  /* The openers use up their time slices, so even under the
+     default FIFO scheduler the main thread gets to run and end
+     each run soon after it wakes up. */
+  for (threads = 1; threads <= MAX_THREADS; threads *= 2)
+    open_run(file_get_inode(file), threads);
+
+  dir_close(root);
+  file_close(file);
+}
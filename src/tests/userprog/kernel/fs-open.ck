@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The test fails by itself if an open found a second inode for
+# the file.  Timings vary from run to run, so here check only that
+# every run reported and made progress.
+for my $threads (1, 2, 4, 8) {
+    my ($rate) = map (/^\(fs-open\) $threads threads: (\d+) opens\/tick\.$/, @output);
+    fail "No run with $threads threads reported.\n" if !defined $rate;
+    fail "No opens with $threads threads.\n" if $rate == 0;
+}
+pass;
@@ -6,6 +6,7 @@
 static const struct test userprog_tests[] = {
     {"fp-kasm", test_fp_kasm},
     {"fp-kinit", test_fp_kinit},
+    {"fs-open", test_fs_open},
 };
 
 /* Runs the userprog test named NAME. */
@@ -0,0 +1,85 @@
+/* Measures lock throughput, first with one thread taking a lock
+   that no other thread wants, then with several threads
+   contending for it, and then with one thread again, now that the
+   process has had several threads.  Lock state lives in user
+   memory, so only the contended case should make system calls,
+   and the last run should cost about as much as the first. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <stdint.h>
+#include <syscall.h>
+#include <pthread.h>
+
+#define UNCONTENDED_OPS 100000 /* Acquire/release pairs by one thread. */
+#define CONTENDED_THREADS 4    /* Threads contending for the lock. */
+#define CONTENDED_OPS 10000    /* Acquire/release pairs by each of them. */
+
+static lock_t lock;
+static int counter;
+
+/* Returns the CPU's time-stamp counter. */
+static uint64_t rdtsc(void) {
+  uint32_t lo, hi;
+
+  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+/* Has the running thread acquire and release the lock
+   UNCONTENDED_OPS times, reports the cost per pair as the run
+   WHEN, and returns it. */
+static uint64_t uncontended(const char* when) {
+  uint64_t start, cycles;
+  int i;
+
+  counter = 0;
+  start = rdtsc();
+  for (i = 0; i < UNCONTENDED_OPS; i++) {
+    lock_acquire(&lock);
+    counter++;
+    lock_release(&lock);
+  }
+  cycles = rdtsc() - start;
+  if (counter != UNCONTENDED_OPS)
+    fail("counter is %d, expected %d", counter, UNCONTENDED_OPS);
+  msg("uncontended %s: %d pairs, %llu cycles per pair", when, UNCONTENDED_OPS,
+      (unsigned long long)(cycles / UNCONTENDED_OPS));
+  return cycles / UNCONTENDED_OPS;
+}
+
+static void contend(void* arg UNUSED) {
+  for (int i = 0; i < CONTENDED_OPS; i++) {
+    lock_acquire(&lock);
+    counter++;
+    lock_release(&lock);
+  }
+}
+
+void test_main(void) {
+  tid_t tids[CONTENDED_THREADS];
+  uint64_t start, cycles, before, after;
+  int i;
+
+  lock_check_init(&lock);
+  before = uncontended("before threads");
+
+  counter = 0;
+  start = rdtsc();
+  for (i = 0; i < CONTENDED_THREADS; i++)
+    tids[i] = pthread_check_create(contend, NULL);
+  for (i = 0; i < CONTENDED_THREADS; i++)
+    pthread_check_join(tids[i]);
+  cycles = rdtsc() - start;
+  if (counter != CONTENDED_THREADS * CONTENDED_OPS)
+    fail("counter is %d, expected %d", counter, CONTENDED_THREADS * CONTENDED_OPS);
+  msg("contended by %d threads: %d pairs, %llu cycles per pair", CONTENDED_THREADS,
+      CONTENDED_THREADS * CONTENDED_OPS,
+      (unsigned long long)(cycles / (CONTENDED_THREADS * CONTENDED_OPS)));
+
+  /* A system call per pair would cost far more than this. */
+  after = uncontended("after threads");
+  if (after > 4 * before + 100)
+    fail("uncontended pairs cost %llu cycles after threads, %llu before",
+         (unsigned long long)after, (unsigned long long)before);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings vary from run to run, so check the format only.  The
+# test fails by itself if uncontended pairs cost much more once the
+# process has had several threads.
+for my $when ("before threads", "after threads") {
+    fail "No uncontended run $when reported.\n"
+      if !grep (/^\(lock-perf\) uncontended $when: 100000 pairs, \d+ cycles per pair$/, @output);
+}
+fail "No contended run reported.\n"
+  if !grep (/^\(lock-perf\) contended by 4 threads: 40000 pairs, \d+ cycles per pair$/, @output);
+fail "lock-perf did not exit cleanly.\n"
+  if !grep (/^lock-perf: exit\(0\)$/, @output);
+pass;
@@ -0,0 +1,32 @@
+/* Takes and releases a lock and a semaphore from a single
+   thread, checks that the lock records the thread's ID as its
+   holder, and then acquires the lock twice, which must terminate
+   the process with exit code 1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void) {
+  lock_t lock;
+  sema_t sema;
+
+  lock_check_init(&lock);
+  lock_acquire(&lock);
+  CHECK(lock.owner == get_tid(), "lock held by this thread");
+  lock_release(&lock);
+  CHECK(lock.owner == TID_ERROR, "lock released");
+
+  sema_check_init(&sema, 1);
+  sema_down(&sema);
+  sema_up(&sema);
+  sema_down(&sema);
+  CHECK(sema.value == 0, "semaphore taken");
+  sema_up(&sema);
+  CHECK(sema.value == 1, "semaphore returned");
+
+  lock_acquire(&lock);
+  msg("acquiring lock again");
+  lock_acquire(&lock);
+  fail("double acquire succeeded");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sync-self) begin
+(sync-self) lock held by this thread
+(sync-self) lock released
+(sync-self) semaphore taken
+(sync-self) semaphore returned
+(sync-self) acquiring lock again
+sync-self: exit(1)
+EOF
+pass;
@@ -0,0 +1,64 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* CPUID leaf 1 feature bits in EDX. */
+#define CPUID_1_EDX_TSC (1u << 4)  /* Time stamp counter. */
+#define CPUID_1_EDX_MSR (1u << 5)  /* RDMSR and WRMSR. */
+#define CPUID_1_EDX_APIC (1u << 9) /* On-chip local APIC. */
+
+/* Executes CPUID with EAX = LEAF and stores the resulting
+   registers into the nonnull output arguments.  See [IA32-v2a]
+   "CPUID". */
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx,
+                         uint32_t* edx) {
+  uint32_t a, b, c, d;
+  asm volatile("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(leaf), "c"(0));
+  if (eax != NULL)
+    *eax = a;
+  if (ebx != NULL)
+    *ebx = b;
+  if (ecx != NULL)
+    *ecx = c;
+  if (edx != NULL)
+    *edx = d;
+}
+
+/* Returns true if the CPU reports all of the CPUID leaf 1 EDX
+   feature bits in FEATURES. */
+static inline bool cpu_has_features(uint32_t features) {
+  uint32_t max_leaf, edx;
+
+  cpuid(0, &max_leaf, NULL, NULL, NULL);
+  if (max_leaf < 1)
+    return false;
+  cpuid(1, NULL, NULL, NULL, &edx);
+  return (edx & features) == features;
+}
+
+/* Returns the value of the time stamp counter.  See [IA32-v2b]
+   "RDTSC". */
+static inline uint64_t rdtsc(void) {
+  uint32_t lo, hi;
+  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+/* Returns the value of model-specific register MSR.  See
+   [IA32-v2b] "RDMSR". */
+static inline uint64_t rdmsr(uint32_t msr) {
+  uint32_t lo, hi;
+  asm volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+/* Writes VALUE to model-specific register MSR.  See [IA32-v2b]
+   "WRMSR". */
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+  asm volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+#endif /* threads/cpu.h */
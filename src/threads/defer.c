@@ -0,0 +1,148 @@
+#include "threads/defer.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A CPU's deferred work queues. */
+struct defer_queue {
+  struct list on_return;  /* Items for defer_run_on_return(). */
+  struct list worker;     /* Items for the worker thread. */
+  struct semaphore ready; /* Upped once per item in WORKER. */
+};
+
+static struct defer_queue queues[CPU_MAX];
+
+bool defer_enabled = true;
+
+/* Statistics. */
+static long long on_return_runs; /* Items run on interrupt return. */
+static long long inline_runs;    /* Items run inside the handler. */
+static long long worker_runs;    /* Items run by worker threads. */
+
+static thread_func worker_thread;
+
+/* Initializes the deferred work queues.  Must be called before
+   any interrupt handler queues work. */
+void defer_init(void) {
+  int i;
+
+  for (i = 0; i < CPU_MAX; i++) {
+    list_init(&queues[i].on_return);
+    list_init(&queues[i].worker);
+    sema_init(&queues[i].ready, 0);
+  }
+}
+
+/* Starts a worker thread for the queue of each CPU that started,
+   which need not be the first cpu_cnt.  The workers are not
+   pinned, so they may run anywhere.  Items queued with
+   defer_to_worker() before this wait until it is called.  Must be
+   called after smp_init(). */
+void defer_start(void) {
+  int i;
+
+  for (i = 0; i < CPU_MAX; i++) {
+    char name[24];
+
+    if (!cpus[i].started)
+      continue;
+    snprintf(name, sizeof name, "worker%d", i);
+    thread_create(name, PRI_MAX, worker_thread, &queues[i]);
+  }
+}
+
+/* Initializes W to call FUNC, passing AUX. */
+void deferred_work_init(struct deferred_work* w, defer_func* func, void* aux) {
+  w->func = func;
+  w->aux = aux;
+  w->queued = false;
+}
+
+/* Queues W to run, with interrupts on, as the current external
+   interrupt returns.  If deferral is disabled, runs W at once
+   instead. */
+void defer_on_return(struct deferred_work* w) {
+  ASSERT(intr_context());
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (!defer_enabled) {
+    inline_runs++;
+    w->func(w->aux);
+  } else if (!w->queued) {
+    w->queued = true;
+    list_push_back(&queues[cpu_current()->id].on_return, &w->elem);
+  }
+}
+
+/* Queues W to run in the current CPU's worker thread. */
+void defer_to_worker(struct deferred_work* w) {
+  enum intr_level old_level = intr_disable();
+
+  if (!w->queued) {
+    struct defer_queue* q = &queues[cpu_current()->id];
+
+    w->queued = true;
+    list_push_back(&q->worker, &w->elem);
+    sema_up(&q->ready);
+  }
+  intr_set_level(old_level);
+}
+
+/* Runs the work queued with defer_on_return() on the current
+   CPU, including any that is queued while it runs.  Called by
+   intr_handler() as an external interrupt that interrupted code
+   running with interrupts on is about to return, after the
+   end-of-interrupt.  Interrupts must be off; they are turned on
+   around each item and are off again on return.
+
+   Interrupts that arrive meanwhile queue their work behind the
+   items still waiting, and leave any yield they request to
+   happen when this function's caller returns. */
+void defer_run_on_return(void) {
+  struct cpu* c = cpu_current();
+  struct defer_queue* q = &queues[c->id];
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(!c->in_external_intr && !c->in_deferred_work);
+
+  c->in_deferred_work = true;
+  while (!list_empty(&q->on_return)) {
+    struct deferred_work* w = list_entry(list_pop_front(&q->on_return), struct deferred_work, elem);
+
+    w->queued = false;
+    on_return_runs++;
+    intr_enable();
+    w->func(w->aux);
+    intr_disable();
+  }
+  c->in_deferred_work = false;
+}
+
+/* Prints deferred work statistics. */
+void defer_print_stats(void) {
+  printf("Deferred work: %lld on interrupt return, %lld inline, %lld by workers\n",
+         on_return_runs, inline_runs, worker_runs);
+}
+
+/* Runs the items queued with defer_to_worker() on the CPU whose
+   queue is Q_, forever. */
+static void worker_thread(void* q_) {
+  struct defer_queue* q = q_;
+
+  for (;;) {
+    struct deferred_work* w;
+    enum intr_level old_level;
+
+    sema_down(&q->ready);
+    old_level = intr_disable();
+    w = list_entry(list_pop_front(&q->worker), struct deferred_work, elem);
+    w->queued = false;
+    worker_runs++;
+    intr_set_level(old_level);
+
+    w->func(w->aux);
+  }
+}
@@ -0,0 +1,59 @@
+#ifndef THREADS_DEFER_H
+#define THREADS_DEFER_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Deferred work.
+
+   An external interrupt handler runs with interrupts off, so
+   everything it does delays every other interrupt on its CPU.
+   A handler can instead do only what must happen at once, such
+   as acknowledging the device, and queue the rest as a work item
+   on the running CPU, to be run in one of two ways:
+
+   - defer_on_return() runs the item as the interrupt returns,
+     after the end-of-interrupt, with interrupts on.  Like the
+     handler itself, the item must not sleep: intr_context() is
+     true while it runs, so intr_yield_on_return() works and
+     sema_down(), lock_acquire(), and thread_yield() assert.
+
+   - defer_to_worker() runs the item in the CPU's worker thread,
+     a PRI_MAX kernel thread, where it may sleep.  Each CPU's
+     queue has its own worker, but workers are not pinned to
+     their CPUs: like any thread, one may be stolen or pulled
+     onto another CPU's run queue, so an item may run on a
+     different CPU from the one that queued it.
+
+   Items on each queue run in the order they were queued.
+   Queueing an item that is already queued does nothing, so an
+   item is usually static and a handler that runs again before
+   its work is done simply adds to what the work will find. */
+
+/* Performs a deferred work item, passing AUX. */
+typedef void defer_func(void* aux);
+
+/* A deferred work item. */
+struct deferred_work {
+  struct list_elem elem; /* Element in a CPU's queue. */
+  defer_func* func;      /* Function to call. */
+  void* aux;             /* Argument to pass it. */
+  bool queued;           /* In a queue and not yet started? */
+};
+
+/* If false, defer_on_return() runs items at once, inside the
+   interrupt handler, as if they had not been deferred.  Controlled
+   by the kernel command-line option "-defer". */
+extern bool defer_enabled;
+
+void defer_init(void);
+void defer_start(void);
+
+void deferred_work_init(struct deferred_work*, defer_func*, void* aux);
+void defer_on_return(struct deferred_work*);
+void defer_to_worker(struct deferred_work*);
+void defer_run_on_return(void);
+
+void defer_print_stats(void);
+
+#endif /* threads/defer.h */
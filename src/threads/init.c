@@ -4,14 +4,20 @@
 #include "devices/rtc.h"
 #include "devices/serial.h"
 #include "devices/shutdown.h"
+#include "devices/clock.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/cpu.h"
+#include "threads/defer.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/sched-trace.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include <console.h>
 #include <debug.h>
@@ -80,6 +86,8 @@ static char** read_command_line(void);
 static char** parse_options(char** argv);
 static void run_actions(char** argv);
 static void usage(void);
+static void boot_phase(const char* name);
+static void print_boot_phases(void);
 
 #ifdef FILESYS
 static void locate_block_devices(void);
@@ -92,6 +100,7 @@ int main(void) {
 
   /* Clear BSS. */
   bss_init();
+  boot_phase(NULL);
 
   /* Break command line into arguments and parse options. */
   argv = read_command_line();
@@ -110,6 +119,7 @@ int main(void) {
   palloc_init(user_page_limit);
   malloc_init();
   paging_init();
+  boot_phase("memory");
 
   fpu_init();
 
@@ -121,18 +131,26 @@ int main(void) {
 
   /* Initialize interrupt handlers. */
   intr_init();
+  defer_init();
   timer_init();
+  timer_init_hires();
   kbd_init();
   input_init();
 #ifdef USERPROG
   exception_init();
   syscall_init();
 #endif
+  boot_phase("interrupts");
 
   /* Start thread scheduler and enable interrupts. */
   thread_start();
   serial_init_queue();
+  boot_phase("threads");
   timer_calibrate();
+  boot_phase("calibration");
+  smp_init();
+  boot_phase("smp");
+  defer_start();
 
 #ifdef USERPROG
   /* Give main thread a minimal PCB so it can launch the first process */
@@ -144,8 +162,10 @@ int main(void) {
   ide_init();
   locate_block_devices();
   filesys_init(format_filesys);
+  boot_phase("filesys");
 #endif
 
+  print_boot_phases();
   printf("Boot complete.\n");
 
   /* Run actions specified on kernel command line. */
@@ -263,6 +283,43 @@ static char** parse_options(char** argv) {
 #endif
     else if (!strcmp(name, "-rs"))
       random_init(atoi(value));
+    else if (!strcmp(name, "-lpt"))
+      timer_set_loops_per_tick(atoi(value));
+    else if (!strcmp(name, "-smp"))
+      smp_max_cpus = atoi(value);
+    else if (!strcmp(name, "-thread-cache"))
+      thread_set_cache_limit(atoi(value));
+    else if (!strcmp(name, "-trace"))
+      sched_trace_enabled = true;
+    else if (!strcmp(name, "-defer")) {
+      if (!strcmp(value, "on"))
+        defer_enabled = true;
+      else if (!strcmp(value, "off"))
+        defer_enabled = false;
+      else
+        PANIC("unknown deferral option `%s' (use -h for help)", value);
+    } else if (!strcmp(name, "-slice")) {
+      if (!strcmp(value, "fixed"))
+        thread_adaptive_slice = false;
+      else if (!strcmp(value, "adaptive"))
+        thread_adaptive_slice = true;
+      else
+        PANIC("unknown time slice option `%s' (use -h for help)", value);
+    } else if (!strcmp(name, "-lock")) {
+      if (!strcmp(value, "adaptive"))
+        lock_adaptive = true;
+      else if (!strcmp(value, "block"))
+        lock_adaptive = false;
+      else
+        PANIC("unknown lock option `%s' (use -h for help)", value);
+    } else if (!strcmp(name, "-cond")) {
+      if (!strcmp(value, "morph"))
+        cond_morph = true;
+      else if (!strcmp(value, "wake"))
+        cond_morph = false;
+      else
+        PANIC("unknown condition variable option `%s' (use -h for help)", value);
+    }
     else if (!strcmp(name, "-sched")) {
       if (!strcmp(value, "fifo"))
         scheduler_flags[SCHED_FIFO] = 1;
@@ -272,8 +329,17 @@ static char** parse_options(char** argv) {
         scheduler_flags[SCHED_FAIR] = 1;
       else if (!strcmp(value, "mlfqs"))
         scheduler_flags[SCHED_MLFQS] = 1;
+      else if (!strcmp(value, "stride"))
+        scheduler_flags[SCHED_STRIDE] = 1;
       else
         PANIC("unknown scheduler option `%s' (use -h for help)", value);
+    } else if (!strcmp(name, "-timer")) {
+      if (!strcmp(value, "periodic"))
+        timer_tickless = false;
+      else if (!strcmp(value, "tickless"))
+        timer_tickless = true;
+      else
+        PANIC("unknown timer option `%s' (use -h for help)", value);
     }
 #ifdef USERPROG
     else if (!strcmp(name, "-ul"))
@@ -298,7 +364,7 @@ static char** parse_options(char** argv) {
   else if (sched_flags_set > 1)
     PANIC("too many scheduler flags set: set at most one of \"-sched-fifo\", "
           "\"-sched-prio\", "
-          "\"-sched-fair\", \"-sched-mlfqs\"");
+          "\"-sched-fair\", \"-sched-mlfqs\", \"-sched-stride\"");
   else if (scheduler_flags[SCHED_FIFO])
     active_sched_policy = SCHED_FIFO;
   else if (scheduler_flags[SCHED_PRIO])
@@ -307,6 +373,8 @@ static char** parse_options(char** argv) {
     active_sched_policy = SCHED_FAIR;
   else if (scheduler_flags[SCHED_MLFQS])
     active_sched_policy = SCHED_MLFQS;
+  else if (scheduler_flags[SCHED_STRIDE])
+    active_sched_policy = SCHED_STRIDE;
   else
     PANIC("kernel bug in init.c: unreachable case");
 
@@ -407,6 +475,46 @@ static void run_actions(char** argv) {
   }
 }
 
+/* Boot phase timing.  main() calls boot_phase() at the end of each
+   phase of booting to record a TSC timestamp, and
+   print_boot_phases() reports how long each phase took once the
+   TSC has been calibrated. */
+#define BOOT_PHASE_MAX 8
+
+struct boot_phase {
+  const char* name; /* Phase that ended, or NULL for the start. */
+  uint64_t tsc;     /* TSC value when it ended. */
+};
+
+static struct boot_phase boot_phases[BOOT_PHASE_MAX];
+static size_t boot_phase_cnt;
+
+/* Records the end of the boot phase named NAME, or the start of
+   booting if NAME is null. */
+static void boot_phase(const char* name) {
+  if (boot_phase_cnt < BOOT_PHASE_MAX && cpu_has_features(CPUID_1_EDX_TSC)) {
+    boot_phases[boot_phase_cnt].name = name;
+    boot_phases[boot_phase_cnt].tsc = rdtsc();
+    boot_phase_cnt++;
+  }
+}
+
+/* Prints the time taken by each boot phase recorded so far. */
+static void print_boot_phases(void) {
+  size_t i;
+
+  if (!clock_has_tsc() || boot_phase_cnt < 2)
+    return;
+
+  printf("Boot phases:");
+  for (i = 1; i < boot_phase_cnt; i++)
+    printf(" %s %'" PRIu64 " us%s", boot_phases[i].name,
+           clock_cycles_to_ns(boot_phases[i].tsc - boot_phases[i - 1].tsc) / 1000,
+           i + 1 < boot_phase_cnt ? "," : ";");
+  printf(" total %'" PRIu64 " us.\n",
+         clock_cycles_to_ns(boot_phases[boot_phase_cnt - 1].tsc - boot_phases[0].tsc) / 1000);
+}
+
 /* Prints a kernel command line help message and powers off the
    machine. */
 static void usage(void) {
@@ -442,6 +550,14 @@ static void usage(void) {
 #endif // VM
 #endif // FILESYS
          "  -rs=SEED           Set random number seed to SEED.\n"
+         "  -lpt=N             Use N timer loops per tick instead of calibrating.\n"
+         "  -smp=N             Start at most N CPUs (default: all, up to 8).\n"
+         "  -thread-cache=N    Keep up to N dead thread pages for reuse (default: 32).\n"
+         "  -trace             Trace scheduler events and dump them at power off.\n"
+         "  -slice=POLICY      Use \"fixed\" or \"adaptive\" (default) time slices.\n"
+         "  -defer=on|off      Run deferred interrupt work on return (default) or inline.\n"
+         "  -lock=POLICY       Use \"adaptive\" (default) or \"block\" contended locks.\n"
+         "  -cond=POLICY       Signal waiters by \"morph\" (default) or \"wake\".\n"
          "  -sched-fair        Use alternate non-strict priority scheduler. "
          "Mutually exclusive "
          "with \"-sched-mlfqs\", \"-sched-prio\".\n"
@@ -451,6 +567,10 @@ static void usage(void) {
          "  -sched-prio        Use strict-priority round-robin scheduler. "
          "Mutually exclusive with "
          "\"-sched-fair\", \"-sched-mlfqs\".\n"
+         "  -sched-stride      Use proportional-share stride scheduler; see "
+         "thread_set_tickets().\n"
+         "  -timer=MODE        Run the idle thread with a \"periodic\" timer\n"
+         "                     interrupt (default) or \"tickless\".\n"
 #ifdef USERPROG
          "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif // USERPROG
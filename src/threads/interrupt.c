@@ -3,11 +3,17 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/cpu.h"
+#include "threads/defer.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "devices/clock.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
@@ -46,13 +52,47 @@ static unsigned int unexpected_cnt[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr; /* Are we processing an external interrupt? */
-static bool yield_on_return;  /* Should we yield on interrupt return? */
+   interrupt returns.  Each CPU tracks this separately, in its
+   struct cpu.  Work a handler defers with defer_on_return() runs
+   under the same rules, though with interrupts on. */
+
+/* The kernel lock.  Pintos synchronizes by turning interrupts
+   off, which only excludes other threads on the same CPU, so on
+   a multiprocessor the CPU that turns interrupts off also takes
+   this lock, and gives it up when it turns them back on.  A CPU
+   holds it exactly when it runs kernel code with interrupts off,
+   so every critical section that is safe on one CPU is also safe
+   on several, and the semaphores, locks, and condition variables
+   in synch.c, which are built on turning interrupts off, work
+   unchanged.  The boot CPU starts out with interrupts off, so it
+   starts out holding the lock.
+
+   This is a first step toward SMP, not the end state: every
+   interrupts-off section on every CPU is serialized by this one
+   lock, including the scheduler, the run queues, and the inside
+   of every semaphore and lock operation.  Only code that runs
+   with interrupts on, such as user code and lock-free readers,
+   runs in parallel.  Giving the scheduler and synch.c spinlocks
+   of their own, and shrinking what this lock covers, is left for
+   later. */
+static struct spinlock kernel_lock = {1};
+
+/* Interrupts-off accounting.  Each CPU notes when it turned
+   interrupts off, and where, in its struct cpu; when it turns
+   them back on, the window is compared with the longest seen so
+   far.  Windows are timed with the TSC only, because
+   clock_cycles() falls back to timer_ticks(), which turns
+   interrupts off itself, and the windows before the first
+   intr_enable() on each CPU, which include booting, are not
+   counted.  The globals are updated while holding the kernel
+   lock. */
+static uint64_t intr_off_max;   /* Longest window, in TSC cycles. */
+static void* intr_off_max_from; /* Where it began. */
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init(void);
 static void pic_end_of_interrupt(int irq);
+static bool is_external_vec(int vec_no);
 
 /* Interrupt Descriptor Table helpers. */
 static uint64_t make_intr_gate(void (*)(void), int dpl);
@@ -63,6 +103,10 @@ static inline uint64_t make_idtr_operand(uint16_t limit, void* base);
 void intr_handler(struct intr_frame* args);
 static void unexpected_interrupt(const struct intr_frame*);
 
+/* Interrupts-off accounting helpers. */
+static void intr_off_begin(struct cpu*, void* from);
+static void intr_off_end(struct cpu*);
+
 /* Returns the current interrupt status. */
 enum intr_level intr_get_level(void) {
   uint32_t flags;
@@ -85,12 +129,20 @@ enum intr_level intr_set_level(enum intr_level level) {
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level intr_enable(void) {
   enum intr_level old_level = intr_get_level();
-  ASSERT(!intr_context());
+
+  /* External interrupt handlers run with interrupts off, so only
+     then is there anything to check, and only then is the thread
+     sure to stay on this CPU while we check. */
+  ASSERT(old_level == INTR_ON || !cpu_current()->in_external_intr);
 
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
      Hardware Interrupts". */
+  if (old_level == INTR_OFF) {
+    intr_off_end(cpu_current());
+    spinlock_release(&kernel_lock);
+  }
   asm volatile("sti");
 
   return old_level;
@@ -104,10 +156,59 @@ enum intr_level intr_disable(void) {
      See [IA32-v2b] "CLI" and [IA32-v3a] 5.8.1 "Masking Maskable
      Hardware Interrupts". */
   asm volatile("cli" : : : "memory");
+  if (old_level == INTR_ON) {
+    intr_off_begin(cpu_current(), __builtin_return_address(0));
+    spinlock_acquire(&kernel_lock);
+  }
+
+  return old_level;
+}
+
+/* Disables interrupts on the running CPU only, without taking the
+   kernel lock, and returns the previous interrupt status, for use
+   with intr_local_restore().
 
+   In between, the running thread stays on this CPU and no
+   interrupt handler runs on it, which is enough for reading or
+   updating data that only this CPU touches.  Other CPUs are not
+   excluded, so nothing in between may touch data protected by
+   turning interrupts off with intr_disable(). */
+enum intr_level intr_local_disable(void) {
+  enum intr_level old_level = intr_get_level();
+
+  asm volatile("cli" : : : "memory");
   return old_level;
 }
 
+/* Restores the interrupt status OLD_LEVEL returned by the matching
+   intr_local_disable(). */
+void intr_local_restore(enum intr_level old_level) {
+  if (old_level == INTR_ON)
+    asm volatile("sti" : : : "memory");
+}
+
+/* Enables interrupts and halts the CPU until the next interrupt
+   arrives, for use by the idle thread.  Interrupts must be off
+   on entry; they are on when this function returns.
+
+   The `sti' instruction disables interrupts until the completion
+   of the next instruction, so `sti; hlt' is executed atomically.
+   This atomicity is important; otherwise, an interrupt could be
+   handled between re-enabling interrupts and waiting for the
+   next one to occur, wasting as much as one clock tick worth of
+   time.
+
+   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a] 7.11.1
+   "HLT Instruction". */
+void intr_wait(void) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(!intr_context());
+
+  intr_off_end(cpu_current());
+  spinlock_release(&kernel_lock);
+  asm volatile("sti; hlt" : : : "memory");
+}
+
 /* Initializes the interrupt system. */
 void intr_init(void) {
   uint64_t idtr_operand;
@@ -167,12 +268,27 @@ static void register_handler(uint8_t vec_no, int dpl, enum intr_level level,
 
 /* Registers external interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The handler will
-   execute with interrupts disabled. */
+   execute with interrupts disabled.  VEC_NO must be a PIC vector
+   (0x20...0x2f) or a local APIC device vector (0xf0...0xfe). */
 void intr_register_ext(uint8_t vec_no, intr_handler_func* handler, const char* name) {
-  ASSERT(vec_no >= 0x20 && vec_no <= 0x2f);
+  ASSERT(is_external_vec(vec_no));
   register_handler(vec_no, 0, INTR_OFF, handler, name);
 }
 
+/* Prepares an application processor, which starts with
+   interrupts off, to take interrupts: takes the kernel lock and
+   loads the IDT, which all CPUs share.  intr_init() must already
+   have run on the boot processor. */
+void intr_init_ap(void) {
+  uint64_t idtr_operand;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  spinlock_acquire(&kernel_lock);
+  idtr_operand = make_idtr_operand(sizeof idt - 1, idt);
+  asm volatile("lidt %0" : : "m"(idtr_operand));
+}
+
 /* Registers internal interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The interrupt handler
    will be invoked with interrupt status LEVEL.
@@ -188,13 +304,28 @@ void intr_register_ext(uint8_t vec_no, intr_handler_func* handler, const char* n
    discussion. */
 void intr_register_int(uint8_t vec_no, int dpl, enum intr_level level, intr_handler_func* handler,
                        const char* name) {
-  ASSERT(vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT(!is_external_vec(vec_no));
   register_handler(vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
-bool intr_context(void) { return in_external_intr; }
+/* Returns true during processing of an external interrupt,
+   including work it deferred with defer_on_return(), and false
+   at all other times.
+
+   With interrupts on, the calling thread could be preempted and
+   moved to another CPU between finding its CPU and reading the
+   flags, and would then see that CPU's flags instead of its own,
+   so interrupts are turned off while reading them.  The flags are
+   written only by their own CPU, so the kernel lock is not
+   needed. */
+bool intr_context(void) {
+  enum intr_level old_level = intr_local_disable();
+  struct cpu* c = cpu_current();
+  bool in_context = c->in_external_intr || c->in_deferred_work;
+
+  intr_local_restore(old_level);
+  return in_context;
+}
 
 /* During processing of an external interrupt, directs the
    interrupt handler to yield to a new process just before
@@ -202,7 +333,7 @@ bool intr_context(void) { return in_external_intr; }
    time. */
 void intr_yield_on_return(void) {
   ASSERT(intr_context());
-  yield_on_return = true;
+  cpu_current()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -250,6 +381,12 @@ static void pic_end_of_interrupt(int irq) {
     outb(0xa0, 0x20);
 }
 
+/* Returns true if VEC_NO is an external interrupt vector, that
+   is, one delivered by the PICs or a local APIC device. */
+static bool is_external_vec(int vec_no) {
+  return (vec_no >= 0x20 && vec_no <= 0x2f) || (vec_no >= 0xf0 && vec_no <= 0xfe);
+}
+
 /* Creates an gate that invokes FUNCTION.
 
    The gate has descriptor privilege level DPL, meaning that it
@@ -317,20 +454,31 @@ static inline bool is_trap_from_userspace(struct intr_frame* frame) {
    intr-stubs.S.  FRAME describes the interrupt and the
    interrupted thread's registers. */
 void intr_handler(struct intr_frame* frame) {
+  struct cpu* c;
   bool external;
   intr_handler_func* handler;
 
+  /* An interrupt gate turned interrupts off on the way in.  If
+     they were on before, take the kernel lock now, as
+     intr_disable() would have. */
+  if ((frame->eflags & FLAG_IF) != 0 && intr_get_level() == INTR_OFF) {
+    intr_off_begin(cpu_current(), (void*)intr_handlers[frame->vec_no]);
+    spinlock_acquire(&kernel_lock);
+  }
+
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
      and they need to be acknowledged on the PIC (see below).
      An external interrupt handler cannot sleep. */
-  external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+  external = is_external_vec(frame->vec_no);
   if (external) {
+    c = cpu_current();
     ASSERT(intr_get_level() == INTR_OFF);
-    ASSERT(!intr_context());
+    ASSERT(!c->in_external_intr);
 
-    in_external_intr = true;
-    yield_on_return = false;
+    c->in_external_intr = true;
+    if (!c->in_deferred_work)
+      c->yield_on_return = false;
   }
 
   /* Invoke the interrupt's handler. */
@@ -349,12 +497,40 @@ void intr_handler(struct intr_frame* frame) {
     ASSERT(intr_get_level() == INTR_OFF);
     ASSERT(intr_context());
 
-    in_external_intr = false;
-    pic_end_of_interrupt(frame->vec_no);
-
-    if (yield_on_return)
-      thread_yield();
+    c->in_external_intr = false;
+    if (frame->vec_no < 0x30)
+      pic_end_of_interrupt(frame->vec_no);
+    else
+      lapic_eoi();
+
+    /* Run deferred work, then yield if the handler or the work
+       asked to.  An interrupt that arrives while deferred work
+       is running leaves both to the interrupt it interrupted. */
+    if (!c->in_deferred_work) {
+      if ((frame->eflags & FLAG_IF) != 0)
+        defer_run_on_return();
+      if (c->yield_on_return) {
+        /* An RCU reader yields when it finishes instead. */
+        struct thread* cur = thread_current();
+
+        if (cur->rcu_nesting > 0)
+          cur->rcu_yield_pending = true;
+        else
+          thread_yield();
+      }
+    }
   }
+
+  /* Leave the kernel lock as the interrupted code expects it: free
+     if it ran with interrupts on, held if it ran with them off,
+     even if the handler turned interrupts on in between. */
+  if ((frame->eflags & FLAG_IF) != 0) {
+    if (intr_get_level() == INTR_OFF) {
+      intr_off_end(cpu_current());
+      spinlock_release(&kernel_lock);
+    }
+  } else if (intr_get_level() == INTR_ON)
+    intr_disable();
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -395,3 +571,52 @@ void intr_dump_frame(const struct intr_frame* f) {
 
 /* Returns the name of interrupt VEC. */
 const char* intr_name(uint8_t vec) { return intr_names[vec]; }
+
+/* Returns the longest time, in nanoseconds, that any CPU has run
+   with interrupts off since boot or the last call to
+   intr_reset_max_off(). */
+uint64_t intr_get_max_off_ns(void) {
+  enum intr_level old_level = intr_disable();
+  uint64_t max = intr_off_max;
+  intr_set_level(old_level);
+
+  return clock_cycles_to_ns(max);
+}
+
+/* Forgets the longest interrupts-off window seen so far. */
+void intr_reset_max_off(void) {
+  enum intr_level old_level = intr_disable();
+  intr_off_max = 0;
+  intr_off_max_from = NULL;
+  intr_set_level(old_level);
+}
+
+/* Prints interrupt statistics. */
+void intr_print_stats(void) {
+  if (clock_has_tsc())
+    printf("Interrupts: off for at most %" PRIu64 " us, from %p\n",
+           clock_cycles_to_ns(intr_off_max) / 1000, intr_off_max_from);
+}
+
+/* Notes that CPU C has just turned interrupts off, in the
+   function that returns to FROM or in interrupt handler FROM. */
+static void intr_off_begin(struct cpu* c, void* from) {
+  if (clock_has_tsc()) {
+    c->intr_off_since = rdtsc();
+    c->intr_off_from = from;
+  }
+}
+
+/* Notes that CPU C, holding the kernel lock, is about to turn
+   interrupts on. */
+static void intr_off_end(struct cpu* c) {
+  if (c->intr_off_since != 0) {
+    uint64_t cycles = rdtsc() - c->intr_off_since;
+
+    if (cycles > intr_off_max) {
+      intr_off_max = cycles;
+      intr_off_max_from = c->intr_off_from;
+    }
+    c->intr_off_since = 0;
+  }
+}
@@ -14,6 +14,9 @@ enum intr_level intr_get_level(void);
 enum intr_level intr_set_level(enum intr_level);
 enum intr_level intr_enable(void);
 enum intr_level intr_disable(void);
+enum intr_level intr_local_disable(void);
+void intr_local_restore(enum intr_level);
+void intr_wait(void);
 
 /* Interrupt stack frame. */
 struct intr_frame {
@@ -56,12 +59,17 @@ struct intr_frame {
 typedef void intr_handler_func(struct intr_frame*);
 
 void intr_init(void);
+void intr_init_ap(void);
 void intr_register_ext(uint8_t vec, intr_handler_func*, const char* name);
 void intr_register_int(uint8_t vec, int dpl, enum intr_level,
                        intr_handler_func*, const char* name);
 bool intr_context(void);
 void intr_yield_on_return(void);
 
+uint64_t intr_get_max_off_ns(void);
+void intr_reset_max_off(void);
+void intr_print_stats(void);
+
 void intr_dump_frame(const struct intr_frame*);
 const char* intr_name(uint8_t vec);
 
@@ -0,0 +1,181 @@
+#include "threads/lockstat.h"
+#ifdef LOCKSTAT
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "devices/clock.h"
+
+/* Size of the class table.  Once half of it is in use, further
+   sites share the overflow class, to keep probe chains short. */
+#define LOCK_CLASS_CNT 256
+
+/* Number of classes lockstat_print_stats() prints. */
+#define LOCKSTAT_TOP 10
+
+/* Statistics shared by the objects initialized at one site. */
+struct lock_class {
+  const char* name;     /* Expression passed to the init function. */
+  const char* file;     /* Source file of the init call, or NULL if unused. */
+  int line;             /* Line of the init call. */
+  unsigned acquired;    /* Acquisitions. */
+  unsigned contended;   /* Acquisitions that had to wait. */
+  uint64_t wait_cycles; /* Total time spent waiting. */
+  uint64_t max_wait;    /* Longest wait. */
+  uint64_t hold_cycles; /* Total time held. */
+  uint64_t max_hold;    /* Longest hold. */
+};
+
+/* Hash table of classes, keyed on file and line, with linear
+   probing.  Classes are never removed. */
+static struct lock_class classes[LOCK_CLASS_CNT];
+static int class_cnt;
+
+/* Class for sites that do not fit in CLASSES. */
+static struct lock_class overflow_class = {.name = "(other)", .file = "(other)"};
+
+/* Returns the class for FILE and LINE, creating it with NAME if
+   necessary.  Interrupts must be off. */
+static struct lock_class* find_class(const char* name, const char* file, int line) {
+  unsigned i = (hash_string(file) ^ hash_int(line)) % LOCK_CLASS_CNT;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  for (;;) {
+    struct lock_class* c = &classes[i];
+
+    if (c->file == NULL) {
+      if (class_cnt >= LOCK_CLASS_CNT / 2)
+        return &overflow_class;
+      c->name = name;
+      c->file = file;
+      c->line = line;
+      class_cnt++;
+      return c;
+    }
+    if (c->line == line && (c->file == file || !strcmp(c->file, file)))
+      return c;
+    i = (i + 1) % LOCK_CLASS_CNT;
+  }
+}
+
+/* Registers LS, the state of an object named NAME that is being
+   initialized at FILE:LINE. */
+void lockstat_register(struct lockstat* ls, const char* name, const char* file, int line) {
+  enum intr_level old_level = intr_disable();
+
+  ls->class = find_class(name, file, line);
+  ls->held_since = 0;
+  intr_set_level(old_level);
+}
+
+/* Marks LS as not tracked, for an object that is part of another
+   tracked object, such as the guard lock of a readers-writers
+   lock. */
+void lockstat_untracked(struct lockstat* ls) {
+  ls->class = NULL;
+  ls->held_since = 0;
+}
+
+/* Returns a timestamp for lockstat_waited(). */
+uint64_t lockstat_now(void) { return clock_cycles(); }
+
+/* Counts an acquisition of the object whose state is LS, which
+   had to wait if CONTENDED is true, that started at START, a
+   value returned by lockstat_now(). */
+void lockstat_waited(struct lockstat* ls, bool contended, uint64_t start) {
+  struct lock_class* c = ls->class;
+  enum intr_level old_level;
+
+  if (c == NULL)
+    return;
+
+  old_level = intr_disable();
+  c->acquired++;
+  if (contended) {
+    uint64_t wait = clock_cycles() - start;
+
+    c->contended++;
+    c->wait_cycles += wait;
+    if (wait > c->max_wait)
+      c->max_wait = wait;
+  }
+  intr_set_level(old_level);
+}
+
+/* Notes that the object whose state is LS became held. */
+void lockstat_hold_begin(struct lockstat* ls) {
+  if (ls->class != NULL)
+    ls->held_since = clock_cycles();
+}
+
+/* Notes that the object whose state is LS is no longer held. */
+void lockstat_hold_end(struct lockstat* ls) {
+  struct lock_class* c = ls->class;
+  enum intr_level old_level;
+  uint64_t hold;
+
+  if (c == NULL)
+    return;
+
+  hold = clock_cycles() - ls->held_since;
+  old_level = intr_disable();
+  c->hold_cycles += hold;
+  if (hold > c->max_hold)
+    c->max_hold = hold;
+  intr_set_level(old_level);
+}
+
+/* Returns true if class A is less contended than class B. */
+static bool class_less(const struct lock_class* a, const struct lock_class* b) {
+  if (a->contended != b->contended)
+    return a->contended < b->contended;
+  return a->wait_cycles < b->wait_cycles;
+}
+
+/* Returns FILE without the leading "../" components that the
+   build directory adds. */
+static const char* short_file(const char* file) {
+  while (file[0] == '.' && file[1] == '.' && file[2] == '/')
+    file += 3;
+  return file;
+}
+
+/* Prints the LOCKSTAT_TOP most contended lock classes. */
+void lockstat_print_stats(void) {
+  struct lock_class* top[LOCKSTAT_TOP];
+  int top_cnt = 0;
+  int i, j;
+
+  for (i = 0; i <= LOCK_CLASS_CNT; i++) {
+    struct lock_class* c = i < LOCK_CLASS_CNT ? &classes[i] : &overflow_class;
+
+    if (c->acquired == 0)
+      continue;
+
+    /* Insertion sort into TOP, most contended first. */
+    for (j = top_cnt; j > 0 && class_less(top[j - 1], c); j--)
+      if (j < LOCKSTAT_TOP)
+        top[j] = top[j - 1];
+    if (j < LOCKSTAT_TOP) {
+      top[j] = c;
+      if (top_cnt < LOCKSTAT_TOP)
+        top_cnt++;
+    }
+  }
+
+  printf("Lockstat: %d lock classes, most contended:\n", class_cnt);
+  for (i = 0; i < top_cnt; i++) {
+    struct lock_class* c = top[i];
+
+    printf("  %s (%s:%d): %u acquired, %u contended, "
+           "wait %llu us total, %llu us max, hold %llu us total, %llu us max\n",
+           c->name, short_file(c->file), c->line, c->acquired, c->contended,
+           (unsigned long long)(clock_cycles_to_ns(c->wait_cycles) / 1000),
+           (unsigned long long)(clock_cycles_to_ns(c->max_wait) / 1000),
+           (unsigned long long)(clock_cycles_to_ns(c->hold_cycles) / 1000),
+           (unsigned long long)(clock_cycles_to_ns(c->max_hold) / 1000));
+  }
+}
+#endif /* LOCKSTAT */
@@ -0,0 +1,54 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Lock contention profiler.
+
+   Built with "make LOCKSTAT=1", which defines LOCKSTAT, every
+   semaphore, lock, and readers-writers lock is registered when it
+   is initialized under the expression passed to sema_init(),
+   lock_init(), or rw_lock_init() and the file and line of that
+   call.  Objects initialized at the same site share one lock
+   class, so that, for example, the locks of every malloc()
+   descriptor add up, and the statistics outlive the objects.
+
+   Each class counts acquisitions, acquisitions that had to wait,
+   and the total and longest times spent waiting and holding.
+   Semaphores have no holder, so their hold times stay zero.
+   lockstat_print_stats() prints the most contended classes at
+   shutdown.
+
+   Without LOCKSTAT, struct lockstat is empty and every hook below
+   is a macro that expands to nothing. */
+
+#ifdef LOCKSTAT
+struct lock_class;
+
+/* Per-object lock statistics state. */
+struct lockstat {
+  struct lock_class* class; /* Class, or NULL if not tracked. */
+  uint64_t held_since;      /* clock_cycles() when it was last acquired. */
+};
+
+void lockstat_register(struct lockstat*, const char* name, const char* file, int line);
+void lockstat_untracked(struct lockstat*);
+uint64_t lockstat_now(void);
+void lockstat_waited(struct lockstat*, bool contended, uint64_t start);
+void lockstat_hold_begin(struct lockstat*);
+void lockstat_hold_end(struct lockstat*);
+void lockstat_print_stats(void);
+#else
+struct lockstat {};
+
+#define lockstat_register(LS, NAME, FILE, LINE) ((void)0)
+#define lockstat_untracked(LS) ((void)0)
+#define lockstat_now() ((uint64_t)0)
+#define lockstat_waited(LS, CONTENDED, START) ((void)(CONTENDED), (void)(START))
+#define lockstat_hold_begin(LS) ((void)0)
+#define lockstat_hold_end(LS) ((void)0)
+#define lockstat_print_stats() ((void)0)
+#endif
+
+#endif /* threads/lockstat.h */
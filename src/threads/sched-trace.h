@@ -0,0 +1,43 @@
+#ifndef THREADS_SCHED_TRACE_H
+#define THREADS_SCHED_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* Scheduler event types. */
+enum sched_event_type {
+  SCHED_EV_ENQUEUE = 1, /* Thread added to a ready queue; ARG is its priority. */
+  SCHED_EV_SWITCH_OUT,  /* Thread stopped running; ARG is its new status. */
+  SCHED_EV_SWITCH_IN,   /* Thread started running; ARG is its priority. */
+  SCHED_EV_BLOCK,       /* Thread blocked. */
+  SCHED_EV_UNBLOCK,     /* Thread unblocked; ARG is the waker's CPU. */
+  SCHED_EV_PREEMPT      /* Timer tick forced running thread to yield. */
+};
+
+/* One scheduler event, as recorded in the trace buffer and
+   dumped, byte for byte, by sched_trace_dump(). */
+struct sched_event {
+  uint64_t tsc;  /* clock_cycles() when recorded. */
+  int32_t tid;   /* Thread the event is about. */
+  uint8_t type;  /* One of enum sched_event_type. */
+  uint8_t cpu;   /* CPU that recorded the event. */
+  int16_t arg;   /* Event-specific argument. */
+};
+
+/* Record scheduler events?  Controlled by the kernel command-line
+   option "-trace". */
+extern bool sched_trace_enabled;
+
+void sched_trace_record(enum sched_event_type, const struct thread*, int arg);
+void sched_trace_dump(void);
+
+/* Records an event of the given TYPE about thread T, if tracing
+   is enabled. */
+static inline void sched_trace(enum sched_event_type type, const struct thread* t, int arg) {
+  if (sched_trace_enabled)
+    sched_trace_record(type, t, arg);
+}
+
+#endif /* threads/sched-trace.h */
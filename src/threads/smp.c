@@ -0,0 +1,352 @@
+#include "threads/smp.h"
+#include <debug.h>
+#include <packed.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#endif
+
+/* Multiprocessor support.
+
+   The boot processor finds the other processors in the BIOS's
+   MP configuration table and starts each one with the local APIC
+   INIT, start-up IPI sequence, after which it runs the startup
+   code in ap-start.S and then ap_main(), which enters the idle
+   loop.  From then on every CPU schedules threads from the same
+   ready queues.
+
+   The kernel synchronizes by turning interrupts off, and on a
+   multiprocessor that also takes the kernel lock (see
+   interrupt.c), so that only one CPU at a time runs kernel code
+   with interrupts off.  That includes the scheduler, so the ready
+   queues and everything else protected by turning interrupts
+   off, including the semaphores and locks in synch.c, need no
+   further locking.  Code that runs with interrupts on, including
+   all user code, runs on every CPU in parallel; everything else
+   is serialized by the kernel lock, which for now stands in for
+   finer-grained locking.
+
+   See [IA32-v3a] 8.4 "Multiple-Processor (MP) Initialization"
+   and [MP], the Intel MultiProcessor Specification, version
+   1.4. */
+
+/* Per-CPU data.  cpus[0] is the boot processor. */
+struct cpu cpus[CPU_MAX];
+
+/* Number of CPUs running. */
+int cpu_cnt = 1;
+
+/* Maximum number of CPUs to start. */
+int smp_max_cpus = CPU_MAX;
+
+/* MP floating pointer structure.  See [MP] 4.1 "MP Floating
+   Pointer Structure". */
+struct mp_fp {
+  char signature[4];   /* "_MP_". */
+  uint32_t config;     /* Physical address of configuration table. */
+  uint8_t length;      /* Length in 16-byte units. */
+  uint8_t spec_rev;    /* Version of the specification. */
+  uint8_t checksum;    /* All bytes must sum to 0. */
+  uint8_t features[5]; /* Feature bytes. */
+} PACKED;
+
+/* MP configuration table header.  See [MP] 4.2 "MP Configuration
+   Table Header". */
+struct mp_config {
+  char signature[4];       /* "PCMP". */
+  uint16_t length;         /* Length of base table, including header. */
+  uint8_t spec_rev;        /* Version of the specification. */
+  uint8_t checksum;        /* All bytes of base table must sum to 0. */
+  char oem_id[8];          /* Manufacturer. */
+  char product_id[12];     /* Product family. */
+  uint32_t oem_table;      /* Physical address of OEM table. */
+  uint16_t oem_table_size; /* Size of OEM table. */
+  uint16_t entry_cnt;      /* Number of entries following the header. */
+  uint32_t lapic_addr;     /* Physical address of local APICs. */
+  uint16_t ext_length;     /* Length of extended entries. */
+  uint8_t ext_checksum;    /* Checksum of extended entries. */
+  uint8_t reserved;
+} PACKED;
+
+/* MP configuration table processor entry.  Every other kind of
+   entry is 8 bytes long.  See [MP] 4.3.1 "Processor Entries". */
+struct mp_processor {
+  uint8_t type;         /* MP_PROCESSOR. */
+  uint8_t apic_id;      /* Local APIC ID. */
+  uint8_t apic_version; /* Local APIC version. */
+  uint8_t flags;        /* MP_CPU_* flags. */
+  uint32_t signature;   /* CPU type. */
+  uint32_t features;    /* CPUID leaf 1 EDX. */
+  uint32_t reserved[2];
+} PACKED;
+
+#define MP_PROCESSOR 0     /* Processor entry type. */
+#define MP_OTHER_SIZE 8    /* Size of the other entry types. */
+#define MP_CPU_ENABLED 0x1 /* Processor is usable. */
+#define MP_CPU_BSP 0x2     /* Processor is the boot processor. */
+
+/* Startup code, in ap-start.S. */
+extern uint8_t ap_start[], ap_start_end[];
+extern uint32_t ap_start_pgdir, ap_start_stack, ap_start_main;
+
+/* Returns a pointer to the copy at LOADER_AP_START of VAR, which
+   must be defined in ap-start.S. */
+#define AP_VAR(VAR) ((uint32_t*)ptov(LOADER_AP_START + ((uint8_t*)&(VAR) - ap_start)))
+
+#ifndef USERPROG
+/* GDTR of the boot processor, shared by the others. */
+static uint64_t ap_gdtr;
+#endif
+
+static int find_cpus(void);
+static bool start_ap(struct cpu*);
+static void ap_main(void) NO_RETURN;
+static intr_handler_func tick_interrupt;
+static intr_handler_func resched_interrupt;
+
+/* Starts the application processors, up to smp_max_cpus CPUs in
+   total.  Must be called after thread_start() and timer
+   calibration, with interrupts on, so that the boot processor
+   does not hold the kernel lock while it waits for the others. */
+void smp_init(void) {
+  uint32_t* pd;
+  bool all_started = true;
+  int found, i;
+
+  ASSERT(intr_get_level() == INTR_ON);
+
+  if (!lapic_present())
+    return;
+  cpus[0].apic_id = lapic_id();
+  found = find_cpus();
+  if (found <= 1)
+    return;
+
+  intr_register_ext(SMP_TICK_VEC, tick_interrupt, "SMP Timer");
+  intr_register_ext(SMP_RESCHED_VEC, resched_interrupt, "SMP Reschedule");
+
+  /* The startup code runs with a copy of the kernel page
+     directory in which the low 4 MB are also mapped one-to-one. */
+  pd = palloc_get_page(0);
+  if (pd == NULL)
+    return;
+  memcpy(pd, init_page_dir, PGSIZE);
+  pd[0] = init_page_dir[pd_no(PHYS_BASE)];
+
+  memcpy(ptov(LOADER_AP_START), ap_start, ap_start_end - ap_start);
+  *AP_VAR(ap_start_pgdir) = vtop(pd);
+  *AP_VAR(ap_start_main) = (uint32_t)ap_main;
+#ifndef USERPROG
+  asm volatile("sgdt %0" : "=m"(ap_gdtr));
+#endif
+
+  /* A CPU that did not start in time may only be slow, and still
+     be running on PD, so then we leave PD allocated. */
+  for (i = 1; i < found; i++)
+    if (!start_ap(&cpus[i]))
+      all_started = false;
+  if (all_started)
+    palloc_free_page(pd);
+
+  /* Only the boot processor takes the PIT's interrupts, so timer
+     ticks must keep coming while the others run threads. */
+  if (cpu_cnt > 1 && timer_tickless) {
+    printf("SMP: tickless idle disabled.\n");
+    timer_tickless = false;
+  }
+  printf("SMP: %d of %d CPUs started.\n", cpu_cnt, found);
+}
+
+/* Returns true if the LENGTH bytes at P sum to 0 modulo 256. */
+static bool checksum_ok(const void* p, size_t length) {
+  const uint8_t* bytes = p;
+  uint8_t sum = 0;
+  size_t i;
+
+  for (i = 0; i < length; i++)
+    sum += bytes[i];
+  return sum == 0;
+}
+
+/* Returns true if the LENGTH bytes at physical address PADDR are
+   mapped at ptov(PADDR). */
+static bool phys_mapped(uintptr_t paddr, size_t length) {
+  return paddr + length <= (uintptr_t)init_ram_pages * PGSIZE;
+}
+
+/* Searches the LENGTH bytes at physical address PADDR for an MP
+   floating pointer structure, which is 16-byte aligned.  Returns
+   it, or a null pointer if there is none. */
+static struct mp_fp* search_fp(uintptr_t paddr, size_t length) {
+  uintptr_t end = paddr + length;
+
+  for (; paddr + sizeof(struct mp_fp) <= end; paddr += 16) {
+    struct mp_fp* fp = ptov(paddr);
+    if (!memcmp(fp->signature, "_MP_", 4) && checksum_ok(fp, sizeof *fp))
+      return fp;
+  }
+  return NULL;
+}
+
+/* Returns the MP floating pointer structure, or a null pointer
+   if the BIOS provides none.  It is in the first kB of the
+   extended BIOS data area, the last kB of base memory, or the
+   BIOS ROM.  See [MP] 4 "MP Configuration Table". */
+static struct mp_fp* find_fp(void) {
+  uint8_t* bda = ptov(0x400);
+  uintptr_t ebda = *(uint16_t*)(bda + 0x0e) << 4;
+  uintptr_t base_end = *(uint16_t*)(bda + 0x13) * 1024;
+  struct mp_fp* fp = NULL;
+
+  if (ebda != 0)
+    fp = search_fp(ebda, 1024);
+  if (fp == NULL && base_end >= 1024)
+    fp = search_fp(base_end - 1024, 1024);
+  if (fp == NULL)
+    fp = search_fp(0xf0000, 0x10000);
+  return fp;
+}
+
+/* Fills in cpus[] from the processor entries in the MP
+   configuration table, after the boot processor, up to
+   smp_max_cpus in total.  Returns the number of CPUs found,
+   including the boot processor. */
+static int find_cpus(void) {
+  struct mp_fp* fp = find_fp();
+  struct mp_config* config;
+  uint8_t *p, *end;
+  int cnt = 1;
+  int i;
+
+  if (fp == NULL || fp->config == 0 || !phys_mapped(fp->config, sizeof *config))
+    return cnt;
+  config = ptov(fp->config);
+  if (memcmp(config->signature, "PCMP", 4) || !phys_mapped(fp->config, config->length)
+      || !checksum_ok(config, config->length))
+    return cnt;
+
+  p = (uint8_t*)(config + 1);
+  end = (uint8_t*)config + config->length;
+  for (i = 0; i < config->entry_cnt && p < end; i++) {
+    if (*p == MP_PROCESSOR) {
+      struct mp_processor* proc = (struct mp_processor*)p;
+      if ((proc->flags & MP_CPU_ENABLED) && !(proc->flags & MP_CPU_BSP)
+          && proc->apic_id != cpus[0].apic_id && cnt < smp_max_cpus && cnt < CPU_MAX) {
+        cpus[cnt].id = cnt;
+        cpus[cnt].apic_id = proc->apic_id;
+        cnt++;
+      }
+      p += sizeof *proc;
+    } else
+      p += MP_OTHER_SIZE;
+  }
+  return cnt;
+}
+
+/* Starts application processor C, giving it a new idle thread,
+   and waits up to 100 ms for it to come up.  Returns true if
+   successful, false on failure. */
+static bool start_ap(struct cpu* c) {
+  void* stack = thread_create_idle(c);
+  int64_t start;
+  int i;
+
+  if (stack == NULL)
+    return false;
+  *AP_VAR(ap_start_stack) = (uint32_t)stack;
+
+  /* INIT, then up to two start-up IPIs, with the delays from
+     [IA32-v3a] 8.4.4.1 "Typical BSP Initialization Sequence". */
+  lapic_send_init(c->apic_id);
+  timer_mdelay(10);
+  for (i = 0; i < 2 && !c->started; i++) {
+    lapic_send_startup(c->apic_id, LOADER_AP_START);
+    timer_udelay(200);
+  }
+
+  start = timer_ticks();
+  while (!c->started && timer_elapsed(start) < TIMER_FREQ / 10)
+    barrier();
+  if (!c->started) {
+    printf("SMP: CPU with APIC ID %d did not start.\n", c->apic_id);
+    return false;
+  }
+  cpu_cnt++;
+  return true;
+}
+
+/* Called by ap-start.S on an application processor, with
+   interrupts off, on the stack of its idle thread. */
+static void ap_main(void) {
+  struct cpu* c = cpu_current();
+
+  /* Switch to the kernel's own page directory. */
+  asm volatile("movl %0, %%cr3" : : "r"(vtop(init_page_dir)) : "memory");
+
+#ifdef USERPROG
+  gdt_init_ap(c->id);
+#else
+  asm volatile("lgdt %0" : : "m"(ap_gdtr));
+#endif
+  intr_init_ap();
+  fpu_init();
+  lapic_init_ap(SMP_TICK_VEC, TIMER_FREQ);
+
+  c->started = true;
+  thread_start_ap();
+}
+
+/* Wakes up an idle CPU, if there is one, so that it can run a
+   thread that has just become ready.  Does nothing if the
+   running CPU is idle, since it will pick up the thread itself.
+   Must be called with interrupts off. */
+void smp_kick_idle(void) {
+  struct cpu* self;
+  int i;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (cpu_cnt == 1)
+    return;
+  self = cpu_current();
+  if (self->cur == self->idle_thread)
+    return;
+  for (i = 0; i < CPU_MAX; i++) {
+    struct cpu* c = &cpus[i];
+    if (c != self && c->started && c->cur == c->idle_thread) {
+      lapic_send_ipi(c->apic_id, SMP_RESCHED_VEC);
+      return;
+    }
+  }
+}
+
+/* Interrupts CPU C, which must not be the running CPU, so that
+   it reconsiders which thread to run.  Must be called with
+   interrupts off. */
+void smp_reschedule(struct cpu* c) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(c != cpu_current());
+
+  if (c->started)
+    lapic_send_ipi(c->apic_id, SMP_RESCHED_VEC);
+}
+
+/* Local APIC timer interrupt handler on an application
+   processor. */
+static void tick_interrupt(struct intr_frame* args) { thread_tick((args->cs & 3) == 3); }
+
+/* Reschedule IPI handler.  An idle CPU runs the new thread as
+   soon as it returns to the idle loop; a busy one yields if a
+   higher-priority thread has joined its run queue. */
+static void resched_interrupt(struct intr_frame* args UNUSED) { thread_check_preemption(); }
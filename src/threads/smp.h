@@ -0,0 +1,52 @@
+#ifndef THREADS_SMP_H
+#define THREADS_SMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Maximum number of CPUs. */
+#define CPU_MAX 8
+
+/* Interrupt vectors used between CPUs.  Like LAPIC_TIMER_VEC,
+   these are external interrupts from the local APIC. */
+#define SMP_TICK_VEC 0xf1   /* Periodic timer tick on other CPUs. */
+#define SMP_RESCHED_VEC 0xf2 /* Make a CPU reconsider what to run. */
+
+/* Per-CPU data.
+
+   cpus[0] is the boot processor (BSP), which runs main() and
+   takes all of the device interrupts, including the PIT's timer
+   ticks.  The others, the application processors (APs), are
+   started by smp_init() and take only their own local APIC timer
+   and inter-processor interrupts. */
+struct cpu {
+  int id;                     /* Index in cpus[]. */
+  uint8_t apic_id;            /* Local APIC ID. */
+  volatile bool started;      /* Running and taking interrupts? */
+  struct thread* idle_thread; /* Runs when no other thread is ready. */
+  struct thread* cur;         /* Thread running on this CPU. */
+  unsigned thread_ticks;      /* # of timer ticks since last yield. */
+  unsigned slice;             /* Length of the current time slice, in ticks. */
+  int64_t ticks;              /* # of timer ticks taken by this CPU. */
+  int64_t idle_ticks;         /* # of those spent in the idle thread. */
+  bool in_external_intr;      /* Processing an external interrupt? */
+  bool in_deferred_work;      /* Running work deferred to interrupt return? */
+  bool yield_on_return;       /* Should we yield on interrupt return? */
+  uint64_t intr_off_since;    /* TSC when interrupts went off, or 0. */
+  void* intr_off_from;        /* Where they went off. */
+  unsigned rcu_qs;            /* RCU quiescent states passed. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+
+/* Maximum number of CPUs to start, including the BSP.
+   Controlled by the kernel command-line option "-smp". */
+extern int smp_max_cpus;
+
+void smp_init(void);
+struct cpu* cpu_current(void);
+void smp_kick_idle(void);
+void smp_reschedule(struct cpu*);
+
+#endif /* threads/smp.h */
@@ -27,10 +27,44 @@
 */
 
 #include "threads/synch.h"
+#include <atomic.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/defer.h"
 #include "threads/interrupt.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+static void sema_up_locked(struct semaphore*);
+static struct list_elem* sema_next_waiter(struct semaphore*);
+static void lock_release_locked(struct lock*);
+
+/* Initializes spinlock SL as free. */
+void spinlock_init(struct spinlock* sl) { sl->locked = 0; }
+
+/* Acquires SL, busy-waiting until it is free.  Spins on plain
+   reads between attempts, so that waiting CPUs do not fight over
+   the cache line, with PAUSE to tell the CPU it is a spin loop.
+
+   Spinlocks are not recursive: acquiring one already held by the
+   same CPU deadlocks. */
+void spinlock_acquire(struct spinlock* sl) {
+  while (atomic_xchg(&sl->locked, 1) != 0)
+    while (sl->locked)
+      asm volatile("pause");
+}
+
+/* Tries to acquire SL and returns true if successful or false on
+   failure, without waiting. */
+bool spinlock_try_acquire(struct spinlock* sl) { return atomic_xchg(&sl->locked, 1) == 0; }
+
+/* Releases SL, which must be held. */
+void spinlock_release(struct spinlock* sl) {
+  ASSERT(sl->locked);
+  barrier();
+  sl->locked = 0;
+}
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -40,12 +74,23 @@
      decrement it.
 
    - up or "V": increment the value (and wake up one waiting
-     thread, if any). */
+     thread, if any).
+
+   With LOCKSTAT, sema_init() is a macro that also passes the name
+   of SEMA and the call's file and line, to register SEMA with the
+   lock contention profiler, and so are lock_init() and
+   rw_lock_init(). */
+#ifdef LOCKSTAT
+void sema_init_at(struct semaphore* sema, unsigned value, const char* name, const char* file,
+                  int line) {
+#else
 void sema_init(struct semaphore* sema, unsigned value) {
+#endif
   ASSERT(sema != NULL);
 
   sema->value = value;
   list_init(&sema->waiters);
+  lockstat_register(&sema->lockstat, name, file, line);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -56,7 +101,9 @@ void sema_init(struct semaphore* sema, unsigned value) {
    interrupts disabled, but if it sleeps then the next scheduled
    thread will probably turn interrupts back on. */
 void sema_down(struct semaphore* sema) {
+  uint64_t start = lockstat_now();
   enum intr_level old_level;
+  bool waited = false;
 
   ASSERT(sema != NULL);
   ASSERT(!intr_context());
@@ -65,8 +112,10 @@ void sema_down(struct semaphore* sema) {
   while (sema->value == 0) {
     list_push_back(&sema->waiters, &thread_current()->elem);
     thread_block();
+    waited = true;
   }
   sema->value--;
+  lockstat_waited(&sema->lockstat, waited, start);
   intr_set_level(old_level);
 }
 
@@ -84,6 +133,7 @@ bool sema_try_down(struct semaphore* sema) {
   old_level = intr_disable();
   if (sema->value > 0) {
     sema->value--;
+    lockstat_waited(&sema->lockstat, false, 0);
     success = true;
   } else
     success = false;
@@ -94,6 +144,8 @@ bool sema_try_down(struct semaphore* sema) {
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
    and wakes up one thread of those waiting for SEMA, if any.
+   Under the strict-priority and MLFQS schedulers the
+   highest-priority waiter is woken, and it preempts the caller if it outranks it.
 
    This function may be called from an interrupt handler. */
 void sema_up(struct semaphore* sema) {
@@ -102,10 +154,36 @@ void sema_up(struct semaphore* sema) {
   ASSERT(sema != NULL);
 
   old_level = intr_disable();
-  if (!list_empty(&sema->waiters))
-    thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
-  sema->value++;
+  sema_up_locked(sema);
   intr_set_level(old_level);
+
+  thread_check_preemption();
+}
+
+/* Ups SEMA like sema_up(), but leaves it to the caller to yield
+   to the woken thread if it should preempt the caller.
+   Interrupts must be off. */
+static void sema_up_locked(struct semaphore* sema) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (!list_empty(&sema->waiters)) {
+    struct list_elem* e = sema_next_waiter(sema);
+    list_remove(e);
+    thread_unblock(list_entry(e, struct thread, elem));
+  }
+  sema->value++;
+}
+
+/* Returns the element of the thread that sema_up() would wake
+   among SEMA's waiters, of which there must be at least one.
+   Interrupts must be off. */
+static struct list_elem* sema_next_waiter(struct semaphore* sema) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(!list_empty(&sema->waiters));
+
+  if (active_sched_policy == SCHED_PRIO || active_sched_policy == SCHED_MLFQS)
+    return list_max(&sema->waiters, thread_priority_less, NULL);
+  return list_front(&sema->waiters);
 }
 
 static void sema_test_helper(void* sema_);
@@ -154,28 +232,144 @@ static void sema_test_helper(void* sema_) {
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
    instead of a lock. */
+#ifdef LOCKSTAT
+void lock_init_at(struct lock* lock, const char* name, const char* file, int line) {
+#else
 void lock_init(struct lock* lock) {
+#endif
   ASSERT(lock != NULL);
 
   lock->holder = NULL;
   sema_init(&lock->semaphore, 1);
+  lockstat_untracked(&lock->semaphore.lockstat);
+  lockstat_register(&lock->lockstat, name, file, line);
+}
+
+bool lock_adaptive = true;
+
+/* Most times lock_spin() polls a lock before giving up and
+   sleeping, even if its holder is still running. */
+#define LOCK_SPIN_MAX 10000
+
+/* Totals of the statistics of every lock. */
+static struct lock_totals lock_totals;
+
+/* Busy-waits, with interrupts on, for LOCK to be released as long
+   as its holder is running on another CPU, and returns true if it
+   then acquires LOCK or false if the caller should sleep instead.
+   A short critical section on another CPU ends sooner than it
+   takes to sleep and be woken up again.
+
+   The holder is read without the kernel lock, since taking it
+   would stop the holder from releasing LOCK, so it may be stale.
+   That only costs a wasted poll: thread pages stay mapped after
+   the thread exits, and LOCK_SPIN_MAX bounds the spin.  We also
+   stop spinning once a thread sleeps on LOCK, so that spinners
+   do not keep overtaking it. */
+static bool lock_spin(struct lock* lock) {
+  int spins;
+
+  for (spins = 0; spins < LOCK_SPIN_MAX; spins++) {
+    struct thread* holder = lock->holder;
+
+    if (!list_empty(&lock->semaphore.waiters))
+      return false;
+    if (holder == NULL) {
+      if (sema_try_down(&lock->semaphore))
+        return true;
+    } else if (holder->status != THREAD_RUNNING)
+      return false;
+
+    /* The memory clobber makes us reread LOCK and its holder. */
+    asm volatile("pause" : : : "memory");
+  }
+  return false;
+}
+
+/* Donates thread T's priority to the holder of the lock that T
+   is waiting on, then to the holder of the lock that that thread
+   is waiting on, and so on, for at most PRI_DONATION_DEPTH
+   levels.  Stops early once a holder already runs at T's
+   priority or higher, since everything past it does too. */
+static void donate_priority(struct thread* t) {
+  struct lock* lock = t->waiting_lock;
+  int depth;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  for (depth = 0; depth < PRI_DONATION_DEPTH && lock != NULL && lock->holder != NULL;
+       depth++) {
+    struct thread* holder = lock->holder;
+    if (holder->priority >= t->priority)
+      break;
+    thread_donate_priority(holder, t->priority);
+    lock = holder->waiting_lock;
+  }
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   While we wait, our priority is donated to the lock's holder
+   (and transitively to whatever that thread is waiting on), so
+   that a low-priority holder cannot be starved by medium-priority
+   threads while we are stuck behind it.  Donation is disabled
+   under the MLFQS scheduler, which computes priorities itself.
+   Under the stride scheduler, we transfer our tickets instead.
+
+   With more than one CPU and lock_adaptive set, we first spin
+   while the holder is running on another CPU (see lock_spin()),
+   which is cheaper than sleeping for short critical sections.
+   We cannot spin with interrupts off, because then we hold the
+   kernel lock that the holder needs to release LOCK.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 void lock_acquire(struct lock* lock) {
+  struct thread* cur = thread_current();
+  uint64_t start = lockstat_now();
+  enum intr_level old_level;
+  bool spun = false;
+  bool contended;
+
   ASSERT(lock != NULL);
   ASSERT(!intr_context());
   ASSERT(!lock_held_by_current_thread(lock));
 
-  sema_down(&lock->semaphore);
-  lock->holder = thread_current();
+  if (lock_adaptive && cpu_cnt > 1 && intr_get_level() == INTR_ON && lock->holder != NULL)
+    spun = lock_spin(lock);
+
+  old_level = intr_disable();
+  contended = spun || lock->semaphore.value == 0;
+  if (spun) {
+    lock_totals.contended++;
+    lock_totals.spun++;
+  } else {
+    if (lock->semaphore.value == 0) {
+      lock_totals.contended++;
+      lock_totals.slept++;
+    }
+    if (lock->holder != NULL && active_sched_policy != SCHED_MLFQS) {
+      cur->waiting_lock = lock;
+      if (active_sched_policy == SCHED_STRIDE)
+        thread_transfer_tickets(cur);
+      else
+        donate_priority(cur);
+    }
+    sema_down(&lock->semaphore);
+    cur->waiting_lock = NULL;
+  }
+  lock_totals.acquired++;
+  lockstat_waited(&lock->lockstat, contended, start);
+  lockstat_hold_begin(&lock->lockstat);
+  lock->holder = cur;
+  list_push_back(&cur->held_locks, &lock->elem);
+  if (active_sched_policy == SCHED_STRIDE)
+    thread_update_tickets(cur);
+  intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -191,22 +385,81 @@ bool lock_try_acquire(struct lock* lock) {
   ASSERT(!lock_held_by_current_thread(lock));
 
   success = sema_try_down(&lock->semaphore);
-  if (success)
+  if (success) {
+    enum intr_level old_level = intr_disable();
+    lock_totals.acquired++;
+    lockstat_waited(&lock->lockstat, false, 0);
+    lockstat_hold_begin(&lock->lockstat);
     lock->holder = thread_current();
+    list_push_back(&lock->holder->held_locks, &lock->elem);
+    intr_set_level(old_level);
+  }
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Gives back any priority or tickets given through LOCK, which
+   may cause the current thread to yield to the new holder.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void lock_release(struct lock* lock) {
+  enum intr_level old_level;
+
   ASSERT(lock != NULL);
   ASSERT(lock_held_by_current_thread(lock));
 
+  old_level = intr_disable();
+  lock_release_locked(lock);
+  intr_set_level(old_level);
+
+  thread_check_preemption();
+}
+
+/* Releases LOCK like lock_release(), but leaves it to the caller
+   to yield to the thread it wakes, if that thread should preempt
+   the caller.  Interrupts must be off.
+
+   If the waiter to wake was moved onto LOCK's queue by wait
+   morphing, LOCK passes straight to it, without ever becoming
+   free, so that no other thread can take it first and make the
+   waiter block again. */
+static void lock_release_locked(struct lock* lock) {
+  struct thread* cur = thread_current();
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  lockstat_hold_end(&lock->lockstat);
   lock->holder = NULL;
-  sema_up(&lock->semaphore);
+  list_remove(&lock->elem);
+  if (active_sched_policy == SCHED_STRIDE)
+    thread_update_tickets(cur);
+  else if (active_sched_policy != SCHED_MLFQS)
+    thread_update_priority(cur);
+
+  if (!list_empty(&lock->semaphore.waiters)) {
+    struct list_elem* e = sema_next_waiter(&lock->semaphore);
+    struct thread* t = list_entry(e, struct thread, elem);
+
+    if (t->morph_lock == lock) {
+      list_remove(e);
+      t->morph_lock = NULL;
+      t->waiting_lock = NULL;
+      lock_totals.acquired++;
+      lock_totals.contended++;
+      lock_totals.slept++;
+      lockstat_waited(&lock->lockstat, true, t->morph_since);
+      lockstat_hold_begin(&lock->lockstat);
+      lock->holder = t;
+      list_push_back(&t->held_locks, &lock->elem);
+      if (active_sched_policy == SCHED_STRIDE)
+        thread_update_tickets(t);
+      thread_unblock(t);
+      return;
+    }
+  }
+  sema_up_locked(&lock->semaphore);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -218,16 +471,40 @@ bool lock_held_by_current_thread(const struct lock* lock) {
   return lock->holder == thread_current();
 }
 
-/* Initializes a readers-writers lock */
+/* Copies the totals of every lock's statistics into TOTALS. */
+void lock_get_totals(struct lock_totals* totals) {
+  enum intr_level old_level = intr_disable();
+  *totals = lock_totals;
+  intr_set_level(old_level);
+}
+
+/* Prints the totals of every lock's statistics. */
+void lock_print_stats(void) {
+  printf("Locks: %lld acquisitions, %lld contended, %lld by spinning, %lld after sleeping\n",
+         lock_totals.acquired, lock_totals.contended, lock_totals.spun, lock_totals.slept);
+}
+
+/* Initializes a readers-writers lock.  Its profile covers the
+   time it is held by any reader or writer, not that of its guard
+   lock. */
+#ifdef LOCKSTAT
+void rw_lock_init_at(struct rw_lock* rw_lock, const char* name, const char* file, int line) {
+#else
 void rw_lock_init(struct rw_lock* rw_lock) {
+#endif
   lock_init(&rw_lock->lock);
+  lockstat_untracked(&rw_lock->lock.lockstat);
   cond_init(&rw_lock->read);
   cond_init(&rw_lock->write);
   rw_lock->AR = rw_lock->WR = rw_lock->AW = rw_lock->WW = 0;
+  lockstat_register(&rw_lock->lockstat, name, file, line);
 }
 
 /* Acquire a writer-centric readers-writers lock */
 void rw_lock_acquire(struct rw_lock* rw_lock, bool reader) {
+  uint64_t start = lockstat_now();
+  bool waited = false;
+
   // Must hold the guard lock the entire time
   lock_acquire(&rw_lock->lock);
 
@@ -235,6 +512,7 @@ void rw_lock_acquire(struct rw_lock* rw_lock, bool reader) {
     // Reader code: Block while there are waiting or active writers
     while ((rw_lock->AW + rw_lock->WW) > 0) {
       rw_lock->WR++;
+      waited = true;
       cond_wait(&rw_lock->read, &rw_lock->lock);
       rw_lock->WR--;
     }
@@ -243,11 +521,15 @@ void rw_lock_acquire(struct rw_lock* rw_lock, bool reader) {
     // Writer code: Block while there are any active readers/writers in the system
     while ((rw_lock->AR + rw_lock->AW) > 0) {
       rw_lock->WW++;
+      waited = true;
       cond_wait(&rw_lock->write, &rw_lock->lock);
       rw_lock->WW--;
     }
     rw_lock->AW++;
   }
+  lockstat_waited(&rw_lock->lockstat, waited, start);
+  if (rw_lock->AR + rw_lock->AW == 1)
+    lockstat_hold_begin(&rw_lock->lockstat);
 
   // Release guard lock
   lock_release(&rw_lock->lock);
@@ -271,16 +553,176 @@ void rw_lock_release(struct rw_lock* rw_lock, bool reader) {
     else if (rw_lock->WR > 0)
       cond_broadcast(&rw_lock->read, &rw_lock->lock);
   }
+  if (rw_lock->AR + rw_lock->AW == 0)
+    lockstat_hold_end(&rw_lock->lockstat);
 
   // Release guard lock
   lock_release(&rw_lock->lock);
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem {
-  struct list_elem elem;      /* List element. */
-  struct semaphore semaphore; /* This semaphore. */
-};
+/* Initializes seqlock SL. */
+void seqlock_init(struct seqlock* sl) { sl->seq = 0; }
+
+/* Begins a read of the data protected by SL, waiting for any
+   active writer to finish, and returns a sequence number to pass
+   to seqlock_read_retry(). */
+unsigned seqlock_read_begin(const struct seqlock* sl) {
+  unsigned seq;
+
+  while ((seq = sl->seq) & 1)
+    asm volatile("pause");
+  barrier();
+  return seq;
+}
+
+/* Ends a read of the data protected by SL that began with
+   seqlock_read_begin() returning SEQ.  Returns true if a writer
+   changed the data meanwhile, so that the read must be retried. */
+bool seqlock_read_retry(const struct seqlock* sl, unsigned seq) {
+  barrier();
+  return sl->seq != seq;
+}
+
+/* Begins a write to the data protected by SL.  Interrupts must be
+   off until the matching seqlock_write_end(). */
+void seqlock_write_begin(struct seqlock* sl) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(!(sl->seq & 1));
+
+  sl->seq++;
+  barrier();
+}
+
+/* Ends a write to the data protected by SL. */
+void seqlock_write_end(struct seqlock* sl) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(sl->seq & 1);
+
+  barrier();
+  sl->seq++;
+}
+
+/* Callbacks waiting for a grace period. */
+static struct list rcu_callbacks = LIST_INITIALIZER(rcu_callbacks);
+
+/* Runs the callbacks in rcu_callbacks after a grace period, in a
+   worker thread. */
+static defer_func rcu_run_callbacks;
+static struct deferred_work rcu_work = {.func = rcu_run_callbacks};
+
+/* Statistics. */
+static long long rcu_grace_periods; /* Calls to synchronize_rcu(). */
+static long long rcu_callbacks_run; /* Callbacks run by call_rcu(). */
+
+/* Begins an RCU read-side critical section, which lasts until the
+   matching rcu_read_unlock().  Sections may nest. */
+void rcu_read_lock(void) {
+  thread_current()->rcu_nesting++;
+  barrier();
+}
+
+/* Ends an RCU read-side critical section.  Ending the outermost
+   one yields if the thread would have been preempted meanwhile. */
+void rcu_read_unlock(void) {
+  struct thread* cur = thread_current();
+
+  ASSERT(cur->rcu_nesting > 0);
+
+  barrier();
+  if (--cur->rcu_nesting == 0 && cur->rcu_yield_pending && !intr_context()) {
+    cur->rcu_yield_pending = false;
+    thread_yield();
+  }
+}
+
+/* Waits until every RCU read-side critical section that was in
+   progress when it was called has ended.  Must not be called
+   within a critical section or an interrupt handler.
+
+   Our own CPU is running us, outside any reader, and no thread
+   it switched away from can be inside one, so we only wait for
+   each other CPU to switch threads, take a tick outside a reader,
+   or go idle.  That takes at most a tick or two.  We check every
+   slot in cpus[] that started, not the first cpu_cnt, because an
+   application processor that failed to start leaves a hole. */
+void synchronize_rcu(void) {
+  unsigned qs[CPU_MAX];
+  enum intr_level old_level;
+  int self, i;
+
+  ASSERT(!intr_context());
+  ASSERT(thread_current()->rcu_nesting == 0);
+
+  old_level = intr_disable();
+  self = cpu_current()->id;
+  for (i = 0; i < CPU_MAX; i++)
+    qs[i] = cpus[i].rcu_qs;
+  rcu_grace_periods++;
+  intr_set_level(old_level);
+
+  for (i = 0; i < CPU_MAX; i++) {
+    struct cpu* c = &cpus[i];
+
+    if (i == self || !c->started)
+      continue;
+    while (*(volatile unsigned*)&c->rcu_qs == qs[i] && c->cur != c->idle_thread)
+      timer_sleep(1);
+  }
+}
+
+/* Arranges for FUNC to be called, passing HEAD, in a worker
+   thread after the next grace period.  May be called within an
+   RCU read-side critical section. */
+void call_rcu(struct rcu_head* head, rcu_func* func) {
+  enum intr_level old_level;
+
+  head->func = func;
+  old_level = intr_disable();
+  list_push_back(&rcu_callbacks, &head->elem);
+  intr_set_level(old_level);
+  defer_to_worker(&rcu_work);
+}
+
+/* Runs the callbacks queued so far after a grace period. */
+static void rcu_run_callbacks(void* aux UNUSED) {
+  struct list batch;
+  enum intr_level old_level;
+
+  list_init(&batch);
+  old_level = intr_disable();
+  while (!list_empty(&rcu_callbacks))
+    list_push_back(&batch, list_pop_front(&rcu_callbacks));
+  intr_set_level(old_level);
+
+  synchronize_rcu();
+  while (!list_empty(&batch)) {
+    struct rcu_head* head = list_entry(list_pop_front(&batch), struct rcu_head, elem);
+
+    rcu_callbacks_run++;
+    head->func(head);
+  }
+}
+
+/* Inserts ELEM at the front of LIST, which RCU readers may be
+   traversing.  ELEM is fully linked before it becomes visible, so
+   readers see either the old list or the new one.  The caller
+   must keep other writers out. */
+void rcu_list_push_front(struct list* list, struct list_elem* elem) {
+  struct list_elem* next = list_begin(list);
+
+  elem->prev = next->prev;
+  elem->next = next;
+  barrier();
+  next->prev->next = elem;
+  next->prev = elem;
+}
+
+/* Prints RCU statistics. */
+void rcu_print_stats(void) {
+  printf("RCU: %lld grace periods, %lld callbacks\n", rcu_grace_periods, rcu_callbacks_run);
+}
+
+bool cond_morph = true;
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -312,47 +754,119 @@ void cond_init(struct condition* cond) {
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 void cond_wait(struct condition* cond, struct lock* lock) {
-  struct semaphore_elem waiter;
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
 
   ASSERT(cond != NULL);
   ASSERT(lock != NULL);
   ASSERT(!intr_context());
   ASSERT(lock_held_by_current_thread(lock));
 
-  sema_init(&waiter.semaphore, 0);
-  list_push_back(&cond->waiters, &waiter.elem);
-  lock_release(lock);
-  sema_down(&waiter.semaphore);
-  lock_acquire(lock);
+  /* Releasing LOCK and going to sleep must be atomic, so that a
+     signal cannot slip in between. */
+  old_level = intr_disable();
+  list_push_back(&cond->waiters, &cur->elem);
+  lock_release_locked(lock);
+  thread_block();
+  cur->waiting_lock = NULL;
+  intr_set_level(old_level);
+
+  /* With wait morphing, lock_release() handed LOCK to us. */
+  if (!lock_held_by_current_thread(lock))
+    lock_acquire(lock);
+}
+
+/* Wakes the thread waiting on COND that should go first: the
+   highest-priority one under the strict-priority and MLFQS
+   schedulers, otherwise the one that has waited longest.
+
+   LOCK, which the caller holds, would only make the thread block
+   again at once, so with cond_morph the thread instead moves
+   straight onto LOCK's wait queue, donating to the caller as if
+   it had called lock_acquire().  When its turn comes,
+   lock_release() hands it LOCK, so it wakes once, already holding
+   LOCK.
+   Returns true if a thread became ready and might preempt the
+   caller.  Interrupts must be off. */
+static bool cond_wake_one(struct condition* cond, struct lock* lock) {
+  struct list_elem* e = list_front(&cond->waiters);
+  struct thread* t;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (active_sched_policy == SCHED_PRIO || active_sched_policy == SCHED_MLFQS)
+    e = list_max(&cond->waiters, thread_priority_less, NULL);
+  list_remove(e);
+  t = list_entry(e, struct thread, elem);
+
+  if (!cond_morph) {
+    thread_unblock(t);
+    return true;
+  }
+
+  list_push_back(&lock->semaphore.waiters, &t->elem);
+  t->morph_lock = lock;
+  t->morph_since = lockstat_now();
+  if (active_sched_policy != SCHED_MLFQS) {
+    t->waiting_lock = lock;
+    if (active_sched_policy == SCHED_STRIDE)
+      thread_transfer_tickets(t);
+    else
+      donate_priority(t);
+  }
+  return false;
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   Under the strict-priority and MLFQS schedulers, the
+   highest-priority waiter is chosen.  LOCK must be held before
+   calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
    interrupt handler. */
-void cond_signal(struct condition* cond, struct lock* lock UNUSED) {
+void cond_signal(struct condition* cond, struct lock* lock) {
+  enum intr_level old_level;
+  bool woken = false;
+
   ASSERT(cond != NULL);
   ASSERT(lock != NULL);
   ASSERT(!intr_context());
   ASSERT(lock_held_by_current_thread(lock));
 
+  old_level = intr_disable();
   if (!list_empty(&cond->waiters))
-    sema_up(&list_entry(list_pop_front(&cond->waiters), struct semaphore_elem, elem)->semaphore);
+    woken = cond_wake_one(cond, lock);
+  intr_set_level(old_level);
+
+  if (woken)
+    thread_check_preemption();
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
-   LOCK).  LOCK must be held before calling this function.
+   LOCK), in the order cond_signal() would.  LOCK must be held
+   before calling this function.  With cond_morph, they then
+   acquire LOCK one at a time as it is released, instead of all
+   waking only to block on LOCK.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
    interrupt handler. */
 void cond_broadcast(struct condition* cond, struct lock* lock) {
+  enum intr_level old_level;
+  bool woken = false;
+
   ASSERT(cond != NULL);
   ASSERT(lock != NULL);
+  ASSERT(!intr_context());
+  ASSERT(lock_held_by_current_thread(lock));
 
+  old_level = intr_disable();
   while (!list_empty(&cond->waiters))
-    cond_signal(cond, lock);
+    woken |= cond_wake_one(cond, lock);
+  intr_set_level(old_level);
+
+  if (woken)
+    thread_check_preemption();
 }
@@ -3,14 +3,33 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include "threads/lockstat.h"
+
+/* Spinlock.  Busy-waits instead of sleeping, so it may be used
+   with interrupts off and on any CPU, but should be held only
+   briefly.  The kernel lock beneath intr_disable() is one. */
+struct spinlock {
+  volatile int locked; /* Nonzero while held. */
+};
+
+void spinlock_init(struct spinlock*);
+void spinlock_acquire(struct spinlock*);
+bool spinlock_try_acquire(struct spinlock*);
+void spinlock_release(struct spinlock*);
 
 /* A counting semaphore. */
 struct semaphore {
-  unsigned value;      /* Current value. */
-  struct list waiters; /* List of waiting threads. */
+  unsigned value;           /* Current value. */
+  struct list waiters;      /* List of waiting threads. */
+  struct lockstat lockstat; /* Contention profile. */
 };
 
+#ifdef LOCKSTAT
+void sema_init_at(struct semaphore*, unsigned value, const char* name, const char* file, int line);
+#define sema_init(SEMA, VALUE) sema_init_at(SEMA, VALUE, #SEMA, __FILE__, __LINE__)
+#else
 void sema_init(struct semaphore*, unsigned value);
+#endif
 void sema_down(struct semaphore*);
 bool sema_try_down(struct semaphore*);
 void sema_up(struct semaphore*);
@@ -18,21 +37,50 @@ void sema_self_test(void);
 
 /* Lock. */
 struct lock {
-  struct thread* holder;      /* Thread holding lock (for debugging). */
+  struct thread* holder;      /* Thread holding lock. */
   struct semaphore semaphore; /* Binary semaphore controlling access. */
+  struct list_elem elem;      /* Element in holder's held_locks list. */
+  struct lockstat lockstat;   /* Contention profile. */
 };
 
+/* Totals of the contention statistics of every lock.  Each lock's
+   own profile is in its lockstat, with LOCKSTAT. */
+struct lock_totals {
+  long long acquired;  /* Acquisitions. */
+  long long contended; /* Acquisitions that found the lock held. */
+  long long spun;      /* Acquired by spinning. */
+  long long slept;     /* Acquired after sleeping. */
+};
+
+/* If true, lock_acquire() spins for a lock whose holder is running
+   on another CPU instead of sleeping at once.  Controlled by the
+   kernel command-line option "-lock". */
+extern bool lock_adaptive;
+
+#ifdef LOCKSTAT
+void lock_init_at(struct lock*, const char* name, const char* file, int line);
+#define lock_init(LOCK) lock_init_at(LOCK, #LOCK, __FILE__, __LINE__)
+#else
 void lock_init(struct lock*);
+#endif
 void lock_acquire(struct lock*);
 bool lock_try_acquire(struct lock*);
 void lock_release(struct lock*);
 bool lock_held_by_current_thread(const struct lock*);
+void lock_get_totals(struct lock_totals*);
+void lock_print_stats(void);
 
 /* Condition variable. */
 struct condition {
   struct list waiters; /* List of waiting threads. */
 };
 
+/* If true, cond_signal() and cond_broadcast() move waiters
+   straight onto the lock's wait queue instead of waking them to
+   block on the lock.  Controlled by the kernel command-line
+   option "-cond". */
+extern bool cond_morph;
+
 void cond_init(struct condition*);
 void cond_wait(struct condition*, struct lock*);
 void cond_signal(struct condition*, struct lock*);
@@ -46,12 +94,67 @@ struct rw_lock {
   struct lock lock;
   struct condition read, write;
   int AR, WR, AW, WW;
+  struct lockstat lockstat; /* Contention profile. */
 };
 
+#ifdef LOCKSTAT
+void rw_lock_init_at(struct rw_lock*, const char* name, const char* file, int line);
+#define rw_lock_init(RW_LOCK) rw_lock_init_at(RW_LOCK, #RW_LOCK, __FILE__, __LINE__)
+#else
 void rw_lock_init(struct rw_lock*);
+#endif
 void rw_lock_acquire(struct rw_lock*, bool reader);
 void rw_lock_release(struct rw_lock*, bool reader);
 
+/* Sequence lock.
+
+   Readers never block: a reader copies the data it protects
+   between seqlock_read_begin() and seqlock_read_retry(), and
+   starts over if a writer was active meanwhile.  Writers must
+   have interrupts off, which serializes them, so a seqlock suits
+   small data that is read often and written briefly. */
+struct seqlock {
+  volatile unsigned seq; /* Odd while a writer is active. */
+};
+
+void seqlock_init(struct seqlock*);
+unsigned seqlock_read_begin(const struct seqlock*);
+bool seqlock_read_retry(const struct seqlock*, unsigned seq);
+void seqlock_write_begin(struct seqlock*);
+void seqlock_write_end(struct seqlock*);
+
+/* Read-copy-update.
+
+   Readers of an RCU-protected list traverse it between
+   rcu_read_lock() and rcu_read_unlock() without taking any lock.
+   Writers serialize among themselves, link elements in with
+   rcu_list_push_front(), and may unlink them with list_remove(),
+   but must not free an unlinked element until every reader that
+   might still see it is done: synchronize_rcu() waits for that,
+   and call_rcu() arranges for a function to run afterward.
+
+   A reader must not sleep, and it is not preempted: a preemption
+   requested meanwhile happens at rcu_read_unlock().  So once a
+   CPU has switched threads, or taken a timer tick outside a
+   reader, it has finished every reader it was running, and a
+   grace period ends when every CPU has done so. */
+struct rcu_head;
+typedef void rcu_func(struct rcu_head*);
+
+/* Callback queued with call_rcu(), usually embedded in the
+   object to be freed. */
+struct rcu_head {
+  struct list_elem elem; /* Element in the callback list. */
+  rcu_func* func;        /* Function to call. */
+};
+
+void rcu_read_lock(void);
+void rcu_read_unlock(void);
+void synchronize_rcu(void);
+void call_rcu(struct rcu_head*, rcu_func*);
+void rcu_list_push_front(struct list*, struct list_elem*);
+void rcu_print_stats(void);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
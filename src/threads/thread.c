@@ -5,15 +5,24 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/sched-trace.h"
+#include "threads/smp.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/clock.h"
+#include "devices/timer.h"
+#include <atomic.h>
 #include <debug.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <random.h>
+#include <round.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #ifdef USERPROG
+#include "userprog/cpu-group.h"
 #include "userprog/process.h"
 #endif
 
@@ -22,22 +31,84 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list fifo_ready_list;
+/* Per-CPU run queues for the FIFO, strict-priority, and MLFQS
+   schedulers.  Each CPU runs the threads on its own run queue,
+   which keeps threads on the CPU whose cache holds their working
+   set and keeps each queue short.  The queues are still protected
+   by turning interrupts off, that is, by the kernel lock (see
+   interrupt.c), so CPUs do contend for that lock whenever they
+   touch any run queue; giving each queue its own spinlock is left
+   for when the kernel lock is split.
+
+   A thread that becomes ready goes on the run queue of the CPU it
+   last ran on, whose cache may still hold its working set, or on
+   the running CPU's if it has never run.  A CPU whose run queue
+   is empty steals half of the threads from the busiest one, and
+   every BALANCE_INTERVAL ticks each CPU pulls threads from the
+   busiest run queue if that CPU has at least two more threads
+   than itself, counting the running thread. */
+#define BALANCE_INTERVAL 10 /* Ticks between periodic balancing. */
+struct runqueue {
+  /* Threads in THREAD_READY state, that is, threads that are ready
+     to run but not actually running, under the FIFO scheduler. */
+  struct list fifo_ready_list;
+
+  /* Ready queues for the strict-priority and MLFQS schedulers,
+     one FIFO list per priority level, plus a bitmap in which bit
+     P is set iff prio_ready_lists[P] is nonempty.  Picking the
+     next thread is a bit scan for the highest set bit followed by
+     a list pop. */
+  struct list prio_ready_lists[PRI_MAX + 1];
+  uint64_t prio_ready_bitmap;
+
+  int ready_cnt;     /* Total number of threads in the lists. */
+  long long steals;  /* # of times this CPU stole threads when idle. */
+  long long pulls;   /* # of times periodic balancing pulled threads. */
+  long long taken;   /* # of threads moved here by either one. */
+};
+static struct runqueue runqueues[CPU_MAX];
+
+/* # of times a thread started running on a different CPU from the
+   one it last ran on. */
+static long long migrations;
+
+/* Ready tree for the fair scheduler, ordered by vruntime, so the
+   thread that has received the least weighted CPU time is always
+   the leftmost element. */
+static struct rbtree fair_ready_tree;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Idle thread. */
-static struct thread* idle_thread;
+/* Hash table of all threads that have a TID, indexed by TID, for
+   get_thread_by_tid().  TIDs are handed out sequentially, so the
+   low bits spread them evenly across the buckets.  A fixed array
+   of chains, rather than lib/kernel/hash.c, because threads are
+   added and removed with interrupts off, where malloc() and
+   rehashing are not allowed, and before malloc() is initialized.
+   Protected by disabling interrupts. */
+#define TID_BUCKETS 1024 /* Number of buckets; a power of 2. */
+static struct list tid_buckets[TID_BUCKETS];
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread* initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* TID allocation.  Each CPU hands out TIDs from a private batch
+   of TID_BATCH consecutive TIDs, and reserves a new batch from
+   next_tid_batch with an atomic fetch-and-add when it runs out,
+   so that allocating a TID does not take the kernel lock and CPUs
+   touch the shared counter only once every TID_BATCH threads.
+   Adding the new thread to the TID hash table afterward does take
+   the kernel lock.  See the comment on tid_t in thread.h for the
+   resulting guarantees. */
+#define TID_BATCH 16 /* TIDs reserved by a CPU at a time. */
+static tid_t next_tid_batch = 1; /* First TID of the next unreserved batch. */
+struct tid_batch {
+  tid_t next; /* Next TID to hand out. */
+  tid_t end;  /* One past the last TID in the batch. */
+};
+static struct tid_batch tid_batches[CPU_MAX];
 
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame {
@@ -50,21 +121,140 @@ struct kernel_thread_frame {
 static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
-
-/* Scheduling. */
-#define TIME_SLICE 4          /* # of timer ticks to give each thread. */
-static unsigned thread_ticks; /* # of timer ticks since last yield. */
+static long long idle_wakeups; /* # of times the idle thread woke from halt. */
+
+/* Histogram of wakeup latency, the time from thread_unblock() to
+   the thread running.  Bucket B counts latencies of 2**B to
+   2**(B+1) - 1 microseconds, except that bucket 0 also counts
+   latencies under 1 us and the last bucket has no upper bound. */
+#define LATENCY_BUCKETS 24
+static long long wakeup_latency[LATENCY_BUCKETS];
+
+/* Scheduling.  Each CPU counts its own ticks since the last
+   yield, in struct cpu, and under the FIFO, priority, and MLFQS
+   policies ends the running thread's time slice after c->slice
+   of them.
+
+   With adaptive slices, the default, c->slice is computed as
+   each thread is switched in: SLICE_TARGET_LATENCY ticks divided
+   among the thread and those waiting on the CPU's run queue, but
+   no less than SLICE_MIN_GRANULARITY.  A few CPU-bound threads
+   then switch rarely, while with many of them each still runs
+   about once per SLICE_TARGET_LATENCY.  In addition, a thread
+   that usually blocks within its first tick of running is
+   "interactive": when it is woken, it goes to the front of its
+   run queue and the running thread's slice on its CPU is cut to
+   end at the next tick, so that it does not wait out full slices
+   behind CPU-bound threads.  A thread starts out with a burst of
+   a full TIME_SLICE, so that it must block early to count as
+   interactive, and a slice that ends in preemption counts as a
+   burst, so that a CPU-bound thread does not keep the burst it
+   started with.
+
+   With fixed slices ("-slice=fixed"), every slice is TIME_SLICE
+   ticks. */
+#define TIME_SLICE 4            /* # of timer ticks in a fixed slice. */
+#define SLICE_TARGET_LATENCY 24 /* Ticks to share among ready threads. */
+#define SLICE_MIN_GRANULARITY 1 /* Shortest adaptive slice, in ticks. */
+#define BURST_SHIFT 4           /* Fraction bits of struct thread's burst_avg. */
+bool thread_adaptive_slice = true;
+
+/* MLFQS state.  Blocked threads do not take part in the
+   once-per-second recent_cpu decay; instead, each thread records
+   the last second it was decayed through, and thread_unblock()
+   catches it up using the decay coefficients of the seconds it
+   missed, which are kept in a small ring buffer.  That keeps the
+   per-second work proportional to the number of ready threads. */
+#define MLFQS_DECAY_HISTORY 64             /* Seconds of decay coefficients kept. */
+static fixed_point_t load_avg;             /* System load average. */
+static int64_t mlfqs_seconds;              /* Seconds since boot. */
+static fixed_point_t mlfqs_decay[MLFQS_DECAY_HISTORY]; /* Per-second decay coefficients. */
+
+/* Fair scheduler state.  Each tick charges the running thread
+   FAIR_TICK_VRUNTIME scaled by FAIR_WEIGHT_DEFAULT / weight, where
+   the weight doubles every 8 priority levels, so over any interval
+   the ready threads receive CPU time in proportion to their
+   weights.  fair_min_vruntime tracks the smallest vruntime among
+   runnable threads and never decreases; new and waking threads
+   are placed relative to it so that they neither starve the
+   others nor get starved. */
+#define FAIR_WEIGHT_DEFAULT 1024 /* Weight of a PRI_DEFAULT thread. */
+#define FAIR_TICK_VRUNTIME 1024  /* vruntime per tick at default weight. */
+#define FAIR_MIN_GRANULARITY 2   /* Ticks a thread runs before tick preemption. */
+#define FAIR_WAKEUP_GRANULARITY FAIR_TICK_VRUNTIME /* Lead needed to preempt. */
+#define FAIR_SLEEPER_CREDIT (3 * FAIR_TICK_VRUNTIME) /* Head start for wakers. */
+static int64_t fair_min_vruntime; /* Monotonic minimum vruntime. */
+
+/* fair_weights[P] is round(1024 * 2**((P - PRI_DEFAULT) / 8)). */
+static const int fair_weights[PRI_MAX + 1] = {
+    70,   76,   83,   91,   99,   108,  117,  128,  140,   152,   166,   181,   197,
+    215,  235,  256,  279,  304,  332,  362,  395,  431,  470,   512,   558,   609,
+    664,  724,  790,  861,  939,  1024, 1117, 1218, 1328, 1448,  1579,  1722,  1878,
+    2048, 2233, 2435, 2656, 2896, 3158, 3444, 3756, 4096, 4467,  4871,  5312,  5793,
+    6317, 6889, 7512, 8192, 8933, 9742, 10624, 11585, 12634, 13777, 15024, 16384};
+
+/* Stride scheduler state.  Each thread has a pass, which advances
+   by its stride, STRIDE_LARGE divided by its tickets, for every
+   tick it runs, and the thread with the smallest pass runs next,
+   for one tick at a time.  Over any interval, then, the ready
+   threads receive CPU time in proportion to their tickets, to
+   within a tick each.  stride_min_pass tracks the smallest pass
+   among runnable threads and never decreases; new and waking
+   threads start no earlier than it, so that they cannot claim
+   CPU time for the period they were not competing. */
+#define STRIDE_LARGE (1 << 20) /* Pass per tick at 1 ticket. */
+static struct rbtree stride_ready_tree; /* Ready threads, by pass. */
+static int64_t stride_min_pass;         /* Monotonic minimum pass. */
+
+/* Real-time scheduling state.  Real-time threads are scheduled
+   earliest deadline first, ahead of all threads of the active
+   policy.  Each one runs for at most rt_budget ticks in every
+   rt_period ticks: once its budget runs out it is throttled and
+   parked on rt_throttled_list until its period ends, when its
+   budget is replenished.  Admission control keeps the total
+   utilization at or below 1, the EDF bound for deadlines equal
+   to periods, so a thread that finishes each period's work
+   within its budget never misses a deadline. */
+static struct list rt_ready_list;     /* Ready real-time threads, by deadline. */
+static struct list rt_throttled_list; /* Throttled real-time threads, by deadline. */
+static int64_t rt_utilization;        /* Admitted utilization, in RT_UTIL_SCALE units. */
+static long long rt_admissions;       /* # of successful thread_set_realtime() calls. */
+static long long rt_deadline_misses;  /* # of deadlines missed by any thread. */
+
+/* Cache of pages freed by dying threads.  Creating and destroying
+   a thread through palloc costs zeroing the whole page, and in
+   debug builds filling it with 0xcc again on free, but a new
+   thread only needs its struct thread reset: its stack is written
+   before it is read.  So pages are kept on a free list, linked
+   through their first word, for reuse by thread_create(), up to
+   thread_cache_limit pages; the rest go back to palloc.  Protected
+   by disabling interrupts. */
+#define THREAD_CACHE_DEFAULT 32 /* Default thread_cache_limit. */
+struct cached_page {
+  struct cached_page* next;
+};
+static struct cached_page* thread_cache; /* Free thread pages. */
+static size_t thread_cache_cnt;          /* Number of pages in thread_cache. */
+static size_t thread_cache_limit = THREAD_CACHE_DEFAULT; /* Maximum thread_cache_cnt. */
+static long long thread_cache_hits;      /* # of thread_create()s served from cache. */
+static long long thread_cache_misses;    /* # of thread_create()s that called palloc. */
 
 static void init_thread(struct thread*, const char* name, int priority);
+static struct thread* thread_page_alloc(void);
+static void thread_page_free(struct thread*);
 static bool is_thread(struct thread*) UNUSED;
 static void* alloc_frame(struct thread*, size_t size);
 static void schedule(void);
 static void thread_enqueue(struct thread* t);
 static tid_t allocate_tid(void);
+static tid_t register_tid(struct thread*);
+static struct list* tid_bucket(tid_t);
 void thread_switch_tail(struct thread* prev);
 
 static void kernel_thread(thread_func*, void* aux);
 static void idle(void* aux UNUSED);
+static void idle_loop(void) NO_RETURN;
+static bool is_idle_thread(const struct thread*);
 static struct thread* running_thread(void);
 
 static struct thread* next_thread_to_run(void);
@@ -72,17 +262,54 @@ static struct thread* thread_schedule_fifo(void);
 static struct thread* thread_schedule_prio(void);
 static struct thread* thread_schedule_fair(void);
 static struct thread* thread_schedule_mlfqs(void);
+static struct thread* thread_schedule_stride(void);
 static struct thread* thread_schedule_reserved(void);
+static int highest_ready_priority(const struct runqueue*);
+static bool prio_queues_active(void);
+static bool runqueues_active(void);
+static struct runqueue* this_runqueue(void);
+static void runqueue_push(struct runqueue*, struct thread*);
+static void prio_queue_push(struct runqueue*, struct thread*);
+static void prio_queue_remove(struct thread*);
+static struct thread* prio_queue_pop(struct runqueue*);
+static struct runqueue* busiest_runqueue(const struct runqueue*);
+static int runqueue_pull(struct runqueue*, struct runqueue* from, int cnt);
+static void runqueue_steal(struct runqueue*);
+static void runqueue_balance(struct cpu*);
+static void kick_cpu(struct thread*);
+static bool is_interactive(const struct thread*);
+static void cut_slice(struct cpu*);
+static unsigned slice_length(void);
+static void mlfqs_tick(void);
+static void mlfqs_catch_up(struct thread*);
+static int mlfqs_priority(const struct thread*);
+static bool fair_vruntime_less(const struct rb_elem*, const struct rb_elem*, void* aux);
+static void fair_update_min_vruntime(void);
+static bool fair_should_preempt(const struct thread*);
+static void fair_tick(void);
+static bool stride_pass_less(const struct rb_elem*, const struct rb_elem*, void* aux);
+static struct thread* stride_leftmost(void);
+static void stride_tick(void);
+static int64_t rt_thread_utilization(const struct thread*);
+static bool rt_deadline_less(const struct list_elem*, const struct list_elem*, void* aux);
+static struct thread* rt_ready_front(void);
+static void rt_enqueue(struct thread*);
+static void rt_replenish(struct thread*, int64_t now);
+static void rt_release(void);
+static void rt_leave(struct thread*);
+static int latency_bucket(uint64_t ns);
+static void print_thread_stats(struct thread*, void* aux);
 
 /* Determines which scheduler the kernel should use.
    Controlled by the kernel command-line options
     "-sched=fifo", "-sched=prio",
-    "-sched=fair". "-sched=mlfqs"
+    "-sched=fair". "-sched=mlfqs", "-sched=stride"
    Is equal to SCHED_FIFO by default. */
 enum sched_policy active_sched_policy;
 
 /* Selects a thread to run from the ready list according to
-   some scheduling policy, and returns a pointer to it. */
+   some scheduling policy, and returns a pointer to it, or a null
+   pointer if no thread is ready. */
 typedef struct thread* scheduler_func(void);
 
 /* Jump table for dynamically dispatching the current scheduling
@@ -90,7 +317,7 @@ typedef struct thread* scheduler_func(void);
 scheduler_func* scheduler_jump_table[8]
     = { thread_schedule_fifo,     thread_schedule_prio,
         thread_schedule_fair,     thread_schedule_mlfqs,
-        thread_schedule_reserved, thread_schedule_reserved,
+        thread_schedule_stride,   thread_schedule_reserved,
         thread_schedule_reserved, thread_schedule_reserved };
 
 /* Initializes the threading system by transforming the code
@@ -109,15 +336,28 @@ scheduler_func* scheduler_jump_table[8]
 void thread_init(void) {
   ASSERT(intr_get_level() == INTR_OFF);
 
-  lock_init(&tid_lock);
-  list_init(&fifo_ready_list);
+  for (int c = 0; c < CPU_MAX; c++) {
+    list_init(&runqueues[c].fifo_ready_list);
+    for (int i = PRI_MIN; i <= PRI_MAX; i++)
+      list_init(&runqueues[c].prio_ready_lists[i]);
+  }
+  rb_init(&fair_ready_tree, fair_vruntime_less, NULL);
+  rb_init(&stride_ready_tree, stride_pass_less, NULL);
+  list_init(&rt_ready_list);
+  list_init(&rt_throttled_list);
   list_init(&all_list);
+  for (int i = 0; i < TID_BUCKETS; i++)
+    list_init(&tid_buckets[i]);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread();
   init_thread(initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
-  initial_thread->tid = allocate_tid();
+  register_tid(initial_thread);
+  initial_thread->cpu = &cpus[0];
+  cpus[0].cur = initial_thread;
+  cpus[0].slice = TIME_SLICE;
+  cpus[0].started = true;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -135,30 +375,184 @@ void thread_start(void) {
   sema_down(&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
-void thread_tick(void) {
+/* Creates the idle thread for CPU C, which has not been started
+   yet, and returns the top of its stack.  C should start running
+   on that stack and then call thread_start_ap().  Returns a null
+   pointer if memory is exhausted. */
+void* thread_create_idle(struct cpu* c) {
+  struct thread* t;
+  char name[16];
+
+  t = palloc_get_page(PAL_ZERO);
+  if (t == NULL)
+    return NULL;
+
+  snprintf(name, sizeof name, "idle%d", c->id);
+  init_thread(t, name, PRI_MIN);
+  register_tid(t);
+  t->status = THREAD_RUNNING;
+  t->cpu = c;
+  c->idle_thread = c->cur = t;
+  return t->stack;
+}
+
+/* Starts scheduling threads on an application processor that has
+   just been brought up, running on the stack of the idle thread
+   that thread_create_idle() made for it, with interrupts off. */
+void thread_start_ap(void) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(thread_current() == cpu_current()->idle_thread);
+
+  idle_loop();
+}
+
+/* Called by the timer interrupt handler at each timer tick, with
+   USER true if the tick interrupted user code.  Thus, this
+   function runs in an external interrupt context. */
+void thread_tick(bool user) {
   struct thread* t = thread_current();
+  struct cpu* c = t->cpu;
 
   /* Update statistics. */
-  if (t == idle_thread)
+  c->ticks++;
+  if (t == c->idle_thread) {
     idle_ticks++;
-#ifdef USERPROG
-  else if (t->pcb != NULL)
+    c->idle_ticks++;
+  } else if (user) {
     user_ticks++;
-#endif
-  else
+    t->user_ticks++;
+  } else {
     kernel_ticks++;
+    t->kernel_ticks++;
+  }
+  if (t->rcu_nesting == 0)
+    c->rcu_qs++;
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  /* Real-time periods are global, so only the boot CPU, which
+     takes the PIT's ticks, releases throttled threads. */
+  if (c->id == 0)
+    rt_release();
+#ifdef USERPROG
+  /* So are CPU group periods. */
+  if (c->id == 0)
+    cpu_group_release();
+  if (t != c->idle_thread)
+    cpu_group_tick(t);
+#endif
+  if (active_sched_policy == SCHED_MLFQS)
+    mlfqs_tick();
+
+  /* Enforce preemption.  A real-time thread runs until its
+     budget for the period is gone. */
+  c->thread_ticks++;
+  if (t->rt_period != 0) {
+    if (--t->rt_remaining <= 0) {
+      t->rt_throttled = true;
+      intr_yield_on_return();
+    }
+  } else if (active_sched_policy == SCHED_FAIR)
+    fair_tick();
+  else if (active_sched_policy == SCHED_STRIDE)
+    stride_tick();
+  else if (c->thread_ticks >= c->slice)
     intr_yield_on_return();
+
+  if (cpu_cnt > 1 && runqueues_active() && c->ticks % BALANCE_INTERVAL == 0)
+    runqueue_balance(c);
+
+  if (c->yield_on_return)
+    sched_trace(SCHED_EV_PREEMPT, t, 0);
 }
 
-/* Prints thread statistics. */
+/* Prints thread statistics: totals, the CPU accounting of each
+   live thread, and the wakeup latency histogram. */
 void thread_print_stats(void) {
+  enum intr_level old_level;
+  int first, last, b;
+
   printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
          idle_ticks, kernel_ticks, user_ticks);
+  printf("Idle: %lld wakeups, %lld wakeups/s while idle (%s timer)\n", idle_wakeups,
+         idle_ticks > 0 ? idle_wakeups * TIMER_FREQ / idle_ticks : 0,
+         timer_tickless ? "tickless" : "periodic");
+  if (rt_admissions > 0)
+    printf("Real-time: %lld admissions, %lld deadline misses\n", rt_admissions, rt_deadline_misses);
+  if (cpu_cnt > 1) {
+    for (int i = 0; i < CPU_MAX; i++)
+      if (cpus[i].started)
+        printf("CPU %d: %" PRId64 " ticks, %" PRId64 " idle ticks, %lld steals, %lld pulls, "
+               "%lld threads taken\n",
+               i, cpus[i].ticks, cpus[i].idle_ticks, runqueues[i].steals, runqueues[i].pulls,
+               runqueues[i].taken);
+    printf("Migrations: %lld\n", migrations);
+  }
+  printf("Thread cache: %lld hits, %lld misses, %zu of %zu pages cached\n", thread_cache_hits,
+         thread_cache_misses, thread_cache_cnt, thread_cache_limit);
+
+  old_level = intr_disable();
+  thread_foreach(print_thread_stats, NULL);
+  intr_set_level(old_level);
+
+  for (first = 0; first < LATENCY_BUCKETS && wakeup_latency[first] == 0; first++)
+    continue;
+  for (last = LATENCY_BUCKETS - 1; last >= first && wakeup_latency[last] == 0; last--)
+    continue;
+  if (first <= last)
+    printf("Wakeup latency:\n");
+  for (b = first; b <= last; b++) {
+    long long low = b == 0 ? 0 : 1ll << b;
+    if (b == LATENCY_BUCKETS - 1)
+      printf("  %8lld+         us: %lld\n", low, wakeup_latency[b]);
+    else
+      printf("  %8lld-%-8lld us: %lld\n", low, (2ll << b) - 1, wakeup_latency[b]);
+  }
+}
+
+/* Prints the CPU accounting of thread T.  Used by
+   thread_print_stats() via thread_foreach(). */
+static void print_thread_stats(struct thread* t, void* aux UNUSED) {
+  printf("Thread %d (%s): %" PRId64 " user ticks, %" PRId64 " kernel ticks, %" PRId64
+         " voluntary switches, %" PRId64 " involuntary switches, %" PRIu64 " us ready\n",
+         t->tid, t->name, t->user_ticks, t->kernel_ticks, t->voluntary_switches,
+         t->involuntary_switches, t->ready_ns / 1000);
+}
+
+/* Returns the number of timer ticks spent in the idle thread
+   since boot. */
+long long thread_get_idle_ticks(void) {
+  enum intr_level old_level = intr_disable();
+  long long t = idle_ticks;
+  intr_set_level(old_level);
+  return t;
+}
+
+/* Returns the number of times a thread has started running on a
+   different CPU from the one it last ran on, since boot. */
+long long thread_get_migrations(void) {
+  enum intr_level old_level = intr_disable();
+  long long t = migrations;
+  intr_set_level(old_level);
+  return t;
+}
+
+/* Returns the number of times an idle CPU has stolen threads from
+   another CPU's run queue since boot. */
+long long thread_get_steals(void) {
+  enum intr_level old_level = intr_disable();
+  long long t = 0;
+  for (int i = 0; i < CPU_MAX; i++)
+    t += runqueues[i].steals;
+  intr_set_level(old_level);
+  return t;
+}
+
+/* Returns the number of times the idle thread has woken up from
+   halting since boot. */
+long long thread_get_idle_wakeups(void) {
+  enum intr_level old_level = intr_disable();
+  long long t = idle_wakeups;
+  intr_set_level(old_level);
+  return t;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -173,9 +567,8 @@ void thread_print_stats(void) {
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   Under the strict-priority scheduler, the new thread preempts
+   the running thread if it has a higher priority. */
 tid_t thread_create(const char* name, int priority, thread_func* function,
                     void* aux) {
   struct thread* t;
@@ -187,13 +580,13 @@ tid_t thread_create(const char* name, int priority, thread_func* function,
   ASSERT(function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page(PAL_ZERO);
+  t = thread_page_alloc();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread(t, name, priority);
-  tid = t->tid = allocate_tid();
+  tid = register_tid(t);
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame(t, sizeof *kf);
@@ -212,6 +605,7 @@ tid_t thread_create(const char* name, int priority, thread_func* function,
 
   /* Add to run queue. */
   thread_unblock(t);
+  thread_check_preemption();
 
   return tid;
 }
@@ -231,16 +625,32 @@ void thread_block(void) {
 }
 
 /* Places a thread on the ready structure appropriate for the
-   current active scheduling policy.
+   current active scheduling policy: the run queue of the CPU it
+   last ran on, for the policies with per-CPU run queues.
 
    This function must be called with interrupts turned off. */
 static void thread_enqueue(struct thread* t) {
   ASSERT(intr_get_level() == INTR_OFF);
   ASSERT(is_thread(t));
 
-  if (active_sched_policy == SCHED_FIFO)
-    list_push_back(&fifo_ready_list, &t->elem);
-  else
+  sched_trace(SCHED_EV_ENQUEUE, t, t->priority);
+  if (t->rt_period != 0)
+    rt_enqueue(t);
+  else if (runqueues_active())
+    runqueue_push(t->cpu != NULL ? &runqueues[t->cpu->id] : this_runqueue(), t);
+  else if (active_sched_policy == SCHED_FAIR) {
+    /* A thread that was blocked rejoins at most
+       FAIR_SLEEPER_CREDIT behind the pack: enough of a head start
+       to run promptly, but it cannot bank the time it slept. */
+    if (t->status == THREAD_BLOCKED && t->vruntime < fair_min_vruntime - FAIR_SLEEPER_CREDIT)
+      t->vruntime = fair_min_vruntime - FAIR_SLEEPER_CREDIT;
+    rb_insert(&fair_ready_tree, &t->rbelem);
+  } else if (active_sched_policy == SCHED_STRIDE) {
+    /* A thread that was blocked cannot bank the time it slept. */
+    if (t->status == THREAD_BLOCKED && t->pass < stride_min_pass)
+      t->pass = stride_min_pass;
+    rb_insert(&stride_ready_tree, &t->rbelem);
+  } else
     PANIC("Unimplemented scheduling policy value: %d", active_sched_policy);
 }
 
@@ -259,9 +669,113 @@ void thread_unblock(struct thread* t) {
 
   old_level = intr_disable();
   ASSERT(t->status == THREAD_BLOCKED);
+  sched_trace(SCHED_EV_UNBLOCK, t, cpu_current()->id);
   thread_enqueue(t);
   t->status = THREAD_READY;
+  t->ready_since = clock_ns();
+  t->woken = true;
+  if (thread_adaptive_slice && is_interactive(t))
+    cut_slice(t->cpu != NULL ? t->cpu : cpu_current());
+  kick_cpu(t);
+  intr_set_level(old_level);
+}
+
+/* Returns true if T usually blocks within its first tick of
+   running. */
+static bool is_interactive(const struct thread* t) { return t->burst_avg < (1 << BURST_SHIFT); }
+
+/* Ends the time slice of the thread running on C at C's next
+   tick, if it is running under a sliced policy.  Must be called
+   with interrupts off. */
+static void cut_slice(struct cpu* c) {
+  if (runqueues_active() && !is_idle_thread(c->cur) && c->cur->rt_period == 0
+      && c->slice > c->thread_ticks + SLICE_MIN_GRANULARITY)
+    c->slice = c->thread_ticks + SLICE_MIN_GRANULARITY;
+}
+
+/* Returns the length, in ticks, of the time slice to give the
+   thread being switched in on the current CPU.  Must be called
+   with interrupts off. */
+static unsigned slice_length(void) {
+  int ready = runqueues_active() ? this_runqueue()->ready_cnt : 0;
+  unsigned slice;
+
+  if (!thread_adaptive_slice)
+    return TIME_SLICE;
+  slice = SLICE_TARGET_LATENCY / (ready + 1);
+  return slice > SLICE_MIN_GRANULARITY ? slice : SLICE_MIN_GRANULARITY;
+}
+
+/* Makes sure that some CPU soon considers running T, which was
+   just made ready.  If T went on the run queue of another CPU
+   that is idle, or that is running a lower-priority thread, that
+   CPU is interrupted to reschedule.  Otherwise, an idle CPU, if
+   there is one, is woken up to steal it.  Must be called with
+   interrupts off. */
+static void kick_cpu(struct thread* t) {
+  struct cpu* self = cpu_current();
+  struct cpu* c = t->cpu;
+
+  if (cpu_cnt == 1)
+    return;
+  if (c != NULL && c != self && t->rt_period == 0 && runqueues_active()
+      && (c->cur == c->idle_thread || (prio_queues_active() && t->priority > c->cur->priority)))
+    smp_reschedule(c);
+  else
+    smp_kick_idle();
+}
+
+/* Yields the CPU if the active scheduling policy says that some
+   ready thread should run in preference to the running thread.
+   Within an external interrupt handler, arranges for the yield
+   to happen when the interrupt returns instead, and within an RCU
+   read-side critical section, when the section ends.
+
+   Ready real-time threads preempt any other thread, and a
+   real-time thread is preempted only by one with an earlier
+   deadline.
+
+   Call this after making a thread ready or lowering the running
+   thread's priority. */
+void thread_check_preemption(void) {
+  enum intr_level old_level;
+  struct thread* cur;
+  bool preempt = false;
+
+  old_level = intr_disable();
+  cur = running_thread();
+  if (!is_idle_thread(cur)) {
+    struct thread* rt = rt_ready_front();
+
+    if (cur->rt_period != 0)
+      preempt = rt != NULL && rt->rt_deadline < cur->rt_deadline;
+    else if (rt != NULL)
+      preempt = true;
+    else if (active_sched_policy == SCHED_FAIR)
+      preempt = fair_should_preempt(cur);
+    else if (prio_queues_active())
+      preempt = highest_ready_priority(this_runqueue()) > cur->priority;
+  }
   intr_set_level(old_level);
+
+  if (preempt) {
+    if (intr_context())
+      intr_yield_on_return();
+    else if (cur->rcu_nesting > 0)
+      cur->rcu_yield_pending = true;
+    else
+      thread_yield();
+  }
+}
+
+/* Returns true if thread A has lower priority than thread B, for
+   use with list_max() and friends on lists of `elem' members. */
+bool thread_priority_less(const struct list_elem* a_, const struct list_elem* b_,
+                          void* aux UNUSED) {
+  const struct thread* a = list_entry(a_, struct thread, elem);
+  const struct thread* b = list_entry(b_, struct thread, elem);
+
+  return a->priority < b->priority;
 }
 
 /* Returns the name of the running thread. */
@@ -287,23 +801,24 @@ struct thread* thread_current(void) {
 /* Returns the running thread's tid. */
 tid_t thread_tid(void) { return thread_current()->tid; }
 
-/* Retrieves a thread by its TID from the all_list. */
+/* Returns the live thread with the given TID, or a null pointer
+   if there is none.  Takes constant time on average. */
 struct thread* get_thread_by_tid(tid_t tid) {
+  struct list* bucket = tid_bucket(tid);
   struct list_elem* e;
-  struct thread* t;
-
-  enum intr_level old_level = intr_disable(); /* Disable interrupts */
+  struct thread* found = NULL;
 
-  for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
-    t = list_entry(e, struct thread, allelem);
+  enum intr_level old_level = intr_disable();
+  for (e = list_begin(bucket); e != list_end(bucket); e = list_next(e)) {
+    struct thread* t = list_entry(e, struct thread, tidelem);
     if (t->tid == tid) {
-      intr_set_level(old_level); /* Restore interrupt level */
-      return t;
+      found = t;
+      break;
     }
   }
+  intr_set_level(old_level);
 
-  intr_set_level(old_level); /* Restore interrupt level */
-  return NULL;               /* Thread not found */
+  return found;
 }
 
 /* Deschedules the current thread and destroys it.  Never
@@ -323,7 +838,9 @@ void thread_exit(void) {
   }
 #endif
   intr_disable();
+  rt_leave(cur);
   list_remove(&thread_current()->allelem);
+  list_remove(&thread_current()->tidelem);
   thread_current()->status = THREAD_DYING;
   schedule();
   NOT_REACHED();
@@ -338,9 +855,10 @@ void thread_yield(void) {
   ASSERT(!intr_context());
 
   old_level = intr_disable();
-  if (cur != idle_thread)
+  if (!is_idle_thread(cur))
     thread_enqueue(cur);
   cur->status = THREAD_READY;
+  cur->ready_since = clock_ns();
   schedule();
   intr_set_level(old_level);
 }
@@ -358,68 +876,599 @@ void thread_foreach(thread_action_func* func, void* aux) {
   }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.  Its
+   effective priority stays raised while it holds locks that
+   higher-priority threads are waiting on.  Yields if the running
+   thread no longer has the highest priority. */
 void thread_set_priority(int new_priority) {
-  thread_current()->priority = new_priority;
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+
+  ASSERT(PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  /* The MLFQS scheduler computes priorities itself. */
+  if (active_sched_policy == SCHED_MLFQS)
+    return;
+
+  old_level = intr_disable();
+  cur->base_priority = new_priority;
+  thread_update_priority(cur);
+  intr_set_level(old_level);
+
+  thread_check_preemption();
+}
+
+/* Sets T's effective priority to PRIORITY, moving T to the
+   matching ready queue if it is ready to run. */
+static void set_effective_priority(struct thread* t, int priority) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (t->priority == priority)
+    return;
+  if (t->status == THREAD_READY && !is_idle_thread(t) && t->rt_period == 0
+      && prio_queues_active()) {
+    struct runqueue* rq = t->rq;
+    prio_queue_remove(t);
+    t->priority = priority;
+    prio_queue_push(rq, t);
+  } else
+    t->priority = priority;
+}
+
+/* Raises T's effective priority to PRIORITY, if it is lower.
+   Used by lock_acquire() to donate priority to lock holders.
+   Must be called with interrupts off. */
+void thread_donate_priority(struct thread* t, int priority) {
+  ASSERT(is_thread(t));
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (t->priority < priority)
+    set_effective_priority(t, priority);
+}
+
+/* Recomputes T's effective priority as the maximum of its base
+   priority and the priorities of all threads waiting on locks
+   that T holds.  Used when T releases a lock or changes its base
+   priority.  Must be called with interrupts off. */
+void thread_update_priority(struct thread* t) {
+  int priority = t->base_priority;
+  struct list_elem* e;
+
+  ASSERT(is_thread(t));
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  for (e = list_begin(&t->held_locks); e != list_end(&t->held_locks); e = list_next(e)) {
+    struct list* waiters = &list_entry(e, struct lock, elem)->semaphore.waiters;
+    if (!list_empty(waiters)) {
+      struct thread* w = list_entry(list_max(waiters, thread_priority_less, NULL), struct thread, elem);
+      if (w->priority > priority)
+        priority = w->priority;
+    }
+  }
+  set_effective_priority(t, priority);
 }
 
 /* Returns the current thread's priority. */
 int thread_get_priority(void) { return thread_current()->priority; }
 
-/* Sets the current thread's nice value to NICE. */
-void thread_set_nice(int nice UNUSED) { /* Not yet implemented. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest
+   priority. */
+void thread_set_nice(int nice) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+
+  ASSERT(NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable();
+  cur->nice = nice;
+  if (active_sched_policy == SCHED_MLFQS)
+    cur->priority = mlfqs_priority(cur);
+  intr_set_level(old_level);
+
+  thread_check_preemption();
 }
 
 /* Returns the current thread's nice value. */
-int thread_get_nice(void) {
-  /* Not yet implemented. */
-  return 0;
-}
+int thread_get_nice(void) { return thread_current()->nice; }
 
 /* Returns 100 times the system load average. */
 int thread_get_load_avg(void) {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable();
+  int load_avg_100 = fix_round(fix_scale(load_avg, 100));
+  intr_set_level(old_level);
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu(void) {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable();
+  int recent_cpu_100 = fix_round(fix_scale(thread_current()->recent_cpu, 100));
+  intr_set_level(old_level);
+  return recent_cpu_100;
+}
+
+/* Returns T's MLFQS priority, computed from its recent_cpu and
+   nice values and clamped to [PRI_MIN, PRI_MAX]. */
+static int mlfqs_priority(const struct thread* t) {
+  int priority = PRI_MAX - fix_trunc(fix_unscale(t->recent_cpu, 4)) - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  if (priority > PRI_MAX)
+    return PRI_MAX;
+  return priority;
+}
+
+/* Applies to T's recent_cpu the once-per-second decay for every
+   second since T was last decayed.  If T missed more seconds than
+   the decay history holds, its recent_cpu from before then is
+   treated as fully decayed, which is accurate to a few percent
+   for any load average below 10. */
+static void mlfqs_catch_up(struct thread* t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (mlfqs_seconds - t->recent_cpu_second > MLFQS_DECAY_HISTORY) {
+    t->recent_cpu = fix_int(0);
+    t->recent_cpu_second = mlfqs_seconds - MLFQS_DECAY_HISTORY;
+  }
+  while (t->recent_cpu_second < mlfqs_seconds) {
+    fixed_point_t decay;
+
+    t->recent_cpu_second++;
+    decay = mlfqs_decay[t->recent_cpu_second % MLFQS_DECAY_HISTORY];
+    t->recent_cpu = fix_add(fix_mul(decay, t->recent_cpu), fix_int(t->nice));
+  }
+}
+
+/* Per-tick MLFQS bookkeeping, called from thread_tick() in the
+   timer interrupt.
+
+   Every tick, the running thread's recent_cpu grows by 1.  Every
+   fourth tick, the running thread's priority is recomputed:
+   recent_cpu only changes for the running thread between
+   once-per-second updates, so no other thread's priority can
+   have moved.  Once per second, load_avg is updated and the
+   running and ready threads are decayed and requeued; blocked
+   threads are caught up lazily when they wake (see
+   mlfqs_catch_up()). */
+static void mlfqs_tick(void) {
+  struct thread* cur = thread_current();
+  struct cpu* c = cur->cpu;
+  bool idle = cur == c->idle_thread;
+
+  if (!idle)
+    cur->recent_cpu = fix_add(cur->recent_cpu, fix_int(1));
+
+  /* The once-per-second update is global, so only the boot CPU
+     does it, counting the threads running on every CPU. */
+  if (c->id == 0 && timer_ticks() % TIMER_FREQ == 0) {
+    struct list ready;
+    int ready_threads = 0;
+    fixed_point_t twice_load;
+    int i;
+
+    for (i = 0; i < CPU_MAX; i++) {
+      ready_threads += runqueues[i].ready_cnt;
+      if (cpus[i].started && cpus[i].cur != cpus[i].idle_thread)
+        ready_threads++;
+    }
+
+    load_avg = fix_add(fix_mul(fix_frac(59, 60), load_avg),
+                       fix_scale(fix_frac(1, 60), ready_threads));
+    twice_load = fix_scale(load_avg, 2);
+    mlfqs_seconds++;
+    mlfqs_decay[mlfqs_seconds % MLFQS_DECAY_HISTORY]
+        = fix_div(twice_load, fix_add(twice_load, fix_int(1)));
+
+    for (i = 0; i < CPU_MAX; i++)
+      if (cpus[i].started && cpus[i].cur != cpus[i].idle_thread)
+        mlfqs_catch_up(cpus[i].cur);
+
+    /* Drain each run queue from highest priority to lowest and
+       requeue each thread at its new priority on the same queue. */
+    for (i = 0; i < CPU_MAX; i++) {
+      struct runqueue* rq = &runqueues[i];
+
+      list_init(&ready);
+      while (rq->ready_cnt > 0)
+        list_push_back(&ready, &prio_queue_pop(rq)->elem);
+      while (!list_empty(&ready)) {
+        struct thread* t = list_entry(list_pop_front(&ready), struct thread, elem);
+        mlfqs_catch_up(t);
+        t->priority = mlfqs_priority(t);
+        prio_queue_push(rq, t);
+      }
+    }
+  }
+
+  if (c->ticks % TIME_SLICE == 0 && !idle) {
+    cur->priority = mlfqs_priority(cur);
+    if (highest_ready_priority(&runqueues[c->id]) > cur->priority)
+      intr_yield_on_return();
+  }
+}
+
+/* Returns true if fair scheduler ready tree element A has a
+   smaller vruntime than B. */
+static bool fair_vruntime_less(const struct rb_elem* a_, const struct rb_elem* b_,
+                               void* aux UNUSED) {
+  const struct thread* a = rb_entry(a_, struct thread, rbelem);
+  const struct thread* b = rb_entry(b_, struct thread, rbelem);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Returns the thread with the smallest vruntime in the fair
+   scheduler's ready tree, or a null pointer if it is empty. */
+static struct thread* fair_leftmost(void) {
+  struct rb_elem* e = rb_min(&fair_ready_tree);
+
+  return e != NULL ? rb_entry(e, struct thread, rbelem) : NULL;
+}
+
+/* Advances fair_min_vruntime to the smallest vruntime among the
+   running thread, which must not be the idle thread, and the
+   ready threads, if that is larger. */
+static void fair_update_min_vruntime(void) {
+  struct thread* cur = running_thread();
+  struct thread* left = fair_leftmost();
+  int64_t vruntime = cur->vruntime;
+
+  ASSERT(!is_idle_thread(cur));
+
+  if (left != NULL && left->vruntime < vruntime)
+    vruntime = left->vruntime;
+  if (vruntime > fair_min_vruntime)
+    fair_min_vruntime = vruntime;
+}
+
+/* Returns true if the fair scheduler should switch from running
+   thread CUR to the leftmost ready thread.  A margin of
+   FAIR_WAKEUP_GRANULARITY keeps near-ties from ping-ponging. */
+static bool fair_should_preempt(const struct thread* cur) {
+  struct thread* left = fair_leftmost();
+
+  return left != NULL && left->vruntime + FAIR_WAKEUP_GRANULARITY < cur->vruntime;
+}
+
+/* Per-tick fair scheduler bookkeeping, called from thread_tick()
+   in the timer interrupt.  Charges the running thread for the
+   tick in proportion to the inverse of its weight and yields once
+   it has run for FAIR_MIN_GRANULARITY ticks and is no longer the
+   thread with the least vruntime. */
+static void fair_tick(void) {
+  struct thread* cur = thread_current();
+  struct thread* left;
+
+  if (is_idle_thread(cur))
+    return;
+
+  cur->vruntime += FAIR_TICK_VRUNTIME * FAIR_WEIGHT_DEFAULT / fair_weights[cur->priority];
+  fair_update_min_vruntime();
+
+  left = fair_leftmost();
+  if (cur->cpu->thread_ticks >= FAIR_MIN_GRANULARITY && left != NULL && left->vruntime < cur->vruntime)
+    intr_yield_on_return();
+}
+
+/* Returns true if stride scheduler ready tree element A has a
+   smaller pass than B. */
+static bool stride_pass_less(const struct rb_elem* a_, const struct rb_elem* b_,
+                             void* aux UNUSED) {
+  const struct thread* a = rb_entry(a_, struct thread, rbelem);
+  const struct thread* b = rb_entry(b_, struct thread, rbelem);
+
+  return a->pass < b->pass;
+}
+
+/* Returns the thread with the smallest pass in the stride
+   scheduler's ready tree, or a null pointer if it is empty. */
+static struct thread* stride_leftmost(void) {
+  struct rb_elem* e = rb_min(&stride_ready_tree);
+
+  return e != NULL ? rb_entry(e, struct thread, rbelem) : NULL;
+}
+
+/* Per-tick stride scheduler bookkeeping, called from
+   thread_tick() in the timer interrupt.  Advances the running
+   thread's pass by its stride and yields if another ready thread
+   now has a smaller pass. */
+static void stride_tick(void) {
+  struct thread* cur = thread_current();
+  struct thread* left;
+
+  if (is_idle_thread(cur))
+    return;
+
+  cur->pass += STRIDE_LARGE / cur->eff_tickets;
+  left = stride_leftmost();
+  if (left != NULL && left->pass < cur->pass)
+    intr_yield_on_return();
+}
+
+/* Returns the current thread's number of stride tickets. */
+int thread_get_tickets(void) { return thread_current()->tickets; }
+
+/* Sets the current thread's number of stride tickets to
+   TICKETS, which must be between TICKETS_MIN and TICKETS_MAX.
+   Tickets transferred to the thread by lock waiters are kept. */
+void thread_set_tickets(int tickets) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+
+  ASSERT(TICKETS_MIN <= tickets && tickets <= TICKETS_MAX);
+
+  old_level = intr_disable();
+  cur->tickets = tickets;
+  thread_update_tickets(cur);
+  intr_set_level(old_level);
+}
+
+/* Transfers the running thread's tickets to the holder of the
+   lock it is about to wait for, then on to the holder of the lock
+   that that thread is waiting for, and so on, so that a lock
+   holder competes for the CPU with the tickets of every thread
+   stuck behind it.  Used by lock_acquire() before it blocks.
+   Must be called with interrupts off. */
+void thread_transfer_tickets(struct thread* t) {
+  struct lock* lock = t->waiting_lock;
+  int depth;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  for (depth = 0; depth < PRI_DONATION_DEPTH && lock != NULL && lock->holder != NULL;
+       depth++) {
+    lock->holder->eff_tickets += t->eff_tickets;
+    lock = lock->holder->waiting_lock;
+  }
+}
+
+/* Recomputes T's effective tickets as its own tickets plus those
+   of every thread waiting on a lock that T holds.  Used when T
+   acquires or releases a lock or changes its tickets.  Must be
+   called with interrupts off. */
+void thread_update_tickets(struct thread* t) {
+  int tickets = t->tickets;
+  struct list_elem* e;
+
+  ASSERT(is_thread(t));
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  for (e = list_begin(&t->held_locks); e != list_end(&t->held_locks); e = list_next(e)) {
+    struct list* waiters = &list_entry(e, struct lock, elem)->semaphore.waiters;
+    struct list_elem* w;
+
+    for (w = list_begin(waiters); w != list_end(waiters); w = list_next(w))
+      tickets += list_entry(w, struct thread, elem)->eff_tickets;
+  }
+  t->eff_tickets = tickets;
+}
+
+/* Makes the current thread a real-time thread that needs BUDGET
+   ticks of CPU time in every PERIOD ticks, with each period's
+   deadline at its end.  The first period starts now.  Returns
+   false, leaving the thread unchanged, if admitting it would
+   raise the total utilization of real-time threads above 1.
+   Calling this on a thread that is already real-time changes its
+   parameters, subject to the same admission test.
+
+   A real-time thread should do each period's work and then call
+   thread_wait_period().  If it runs for BUDGET ticks in one
+   period, it is throttled until the next. */
+bool thread_set_realtime(int64_t period, int64_t budget) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+  int64_t utilization, available;
+
+  ASSERT(0 < budget && budget <= period);
+
+  utilization = DIV_ROUND_UP(budget * RT_UTIL_SCALE, period);
+  old_level = intr_disable();
+  available = RT_UTIL_SCALE - rt_utilization + rt_thread_utilization(cur);
+  if (utilization > available) {
+    intr_set_level(old_level);
+    return false;
+  }
+  rt_leave(cur);
+  rt_utilization += utilization;
+  rt_admissions++;
+  cur->rt_period = period;
+  cur->rt_budget = budget;
+  cur->rt_deadline = timer_ticks() + period;
+  cur->rt_remaining = budget;
+  cur->rt_throttled = false;
+  cur->rt_job_done = false;
+  intr_set_level(old_level);
+
+  thread_check_preemption();
+  return true;
+}
+
+/* Returns the current thread to the active scheduling policy,
+   releasing its share of the real-time utilization. */
+void thread_clear_realtime(void) {
+  enum intr_level old_level = intr_disable();
+  rt_leave(thread_current());
+  intr_set_level(old_level);
+
+  thread_check_preemption();
+}
+
+/* Ends the current real-time thread's work for this period and
+   sleeps until the next period begins, with a fresh budget.  If
+   the period has already ended, counts a missed deadline and
+   returns at once, because the next period is already under
+   way. */
+void thread_wait_period(void) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+  int64_t now, deadline;
+
+  ASSERT(cur->rt_period != 0);
+
+  old_level = intr_disable();
+  now = timer_ticks();
+  deadline = cur->rt_deadline;
+  if (now > deadline) {
+    cur->rt_misses++;
+    rt_deadline_misses++;
+  }
+  cur->rt_job_done = true;
+  if (now >= deadline)
+    rt_replenish(cur, now);
+  intr_set_level(old_level);
+
+  if (now < deadline)
+    timer_sleep_until(deadline);
+}
+
+/* Returns the number of deadlines the current thread has
+   missed. */
+int thread_get_deadline_misses(void) { return thread_current()->rt_misses; }
+
+/* Returns the tick at which the next throttled real-time thread
+   gets its budget back, or INT64_MAX if none is throttled.  Must
+   be called with interrupts off. */
+int64_t thread_rt_next_release(void) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (list_empty(&rt_throttled_list))
+    return INT64_MAX;
+  return list_entry(list_front(&rt_throttled_list), struct thread, elem)->rt_deadline;
+}
+
+/* Returns T's share of the CPU as a real-time thread, in
+   RT_UTIL_SCALE units, or 0 if T is not real-time.  Rounds up,
+   so that admission control errs on the safe side. */
+static int64_t rt_thread_utilization(const struct thread* t) {
+  if (t->rt_period == 0)
+    return 0;
+  return DIV_ROUND_UP(t->rt_budget * RT_UTIL_SCALE, t->rt_period);
+}
+
+/* Returns true if real-time thread A has an earlier deadline
+   than B. */
+static bool rt_deadline_less(const struct list_elem* a_, const struct list_elem* b_,
+                             void* aux UNUSED) {
+  const struct thread* a = list_entry(a_, struct thread, elem);
+  const struct thread* b = list_entry(b_, struct thread, elem);
+
+  return a->rt_deadline < b->rt_deadline;
+}
+
+/* Returns the ready real-time thread with the earliest deadline,
+   or a null pointer if there is none. */
+static struct thread* rt_ready_front(void) {
+  if (list_empty(&rt_ready_list))
+    return NULL;
+  return list_entry(list_front(&rt_ready_list), struct thread, elem);
+}
+
+/* Places real-time thread T on the ready list, or on the
+   throttled list if it has used up its budget for the current
+   period.  A thread whose period has ended is replenished
+   first. */
+static void rt_enqueue(struct thread* t) {
+  int64_t now = timer_ticks();
+
+  if (now >= t->rt_deadline)
+    rt_replenish(t, now);
+  list_insert_ordered(t->rt_throttled ? &rt_throttled_list : &rt_ready_list, &t->elem,
+                      rt_deadline_less, NULL);
+}
+
+/* Starts the period of real-time thread T that contains tick
+   NOW, whose previous period ended at or before NOW, with a full
+   budget.  If T had not finished its work for the period that
+   ended, it missed that deadline. */
+static void rt_replenish(struct thread* t, int64_t now) {
+  ASSERT(now >= t->rt_deadline);
+
+  if (!t->rt_job_done) {
+    t->rt_misses++;
+    rt_deadline_misses++;
+  }
+  t->rt_deadline += ((now - t->rt_deadline) / t->rt_period + 1) * t->rt_period;
+  t->rt_remaining = t->rt_budget;
+  t->rt_throttled = false;
+  t->rt_job_done = false;
+}
+
+/* Moves throttled real-time threads whose period has ended back
+   to the ready list, called from thread_tick() in the timer
+   interrupt. */
+static void rt_release(void) {
+  int64_t now = timer_ticks();
+  bool released = false;
+
+  while (!list_empty(&rt_throttled_list)) {
+    struct thread* t = list_entry(list_front(&rt_throttled_list), struct thread, elem);
+    if (t->rt_deadline > now)
+      break;
+    list_pop_front(&rt_throttled_list);
+    rt_replenish(t, now);
+    list_insert_ordered(&rt_ready_list, &t->elem, rt_deadline_less, NULL);
+    released = true;
+  }
+  if (released)
+    thread_check_preemption();
+}
+
+/* Makes T, which must be running, no longer a real-time thread.
+   Does nothing if T is not real-time. */
+static void rt_leave(struct thread* t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (t->rt_period == 0)
+    return;
+  rt_utilization -= rt_thread_utilization(t);
+  t->rt_period = 0;
+  t->vruntime = fair_min_vruntime;
+  t->pass = stride_min_pass;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
-   The idle thread is initially put on the ready list by
-   thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   The boot processor's idle thread is initially put on the ready
+   list by thread_start().  It will be scheduled once initially,
+   at which point it records itself as the CPU's idle thread,
+   "up"s the semaphore passed to it to enable thread_start() to
+   continue, and immediately blocks.  After that, the idle thread
+   never appears in the ready list.  It is returned by
+   next_thread_to_run() as a special case when the ready list is
+   empty.  Each application processor has an idle thread of its
+   own, made by thread_create_idle(), which it starts out
+   running. */
 static void idle(void* idle_started_ UNUSED) {
   struct semaphore* idle_started = idle_started_;
-  idle_thread = thread_current();
+  cpu_current()->idle_thread = thread_current();
   sema_up(idle_started);
+  idle_loop();
+}
+
+/* The body of every CPU's idle thread. */
+static void idle_loop(void) {
+  bool boot_cpu = cpu_current()->id == 0;
 
   for (;;) {
     /* Let someone else run. */
     intr_disable();
     thread_block();
 
-    /* Re-enable interrupts and wait for the next one.
+    /* In tickless mode, stop the periodic timer interrupt until
+       the next thread is due to wake up.  Only the boot
+       processor takes PIT interrupts. */
+    if (boot_cpu)
+      timer_idle_enter();
 
-         The `sti' instruction disables interrupts until the
-         completion of the next instruction, so these two
-         instructions are executed atomically.  This atomicity is
-         important; otherwise, an interrupt could be handled
-         between re-enabling interrupts and waiting for the next
-         one to occur, wasting as much as one clock tick worth of
-         time.
+    /* Re-enable interrupts and wait for the next one. */
+    intr_wait();
 
-         See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-         7.11.1 "HLT Instruction". */
-    asm volatile("sti; hlt" : : : "memory");
+    intr_disable();
+    idle_wakeups++;
+    if (boot_cpu)
+      timer_idle_exit();
   }
 }
 
@@ -444,6 +1493,19 @@ struct thread* running_thread(void) {
   return pg_round_down(esp);
 }
 
+/* Returns the CPU that is running this code.  Before
+   thread_init() has run, that can only be the boot processor. */
+struct cpu* cpu_current(void) {
+  struct thread* t = running_thread();
+
+  return is_thread(t) && t->cpu != NULL ? t->cpu : &cpus[0];
+}
+
+/* Returns true if T is some CPU's idle thread. */
+static bool is_idle_thread(const struct thread* t) {
+  return t->cpu != NULL && t == t->cpu->idle_thread;
+}
+
 /* Returns true if T appears to point to a valid thread. */
 static bool is_thread(struct thread* t) {
   return t != NULL && t->magic == THREAD_MAGIC;
@@ -462,7 +1524,21 @@ static void init_thread(struct thread* t, const char* name, int priority) {
   t->status = THREAD_BLOCKED;
   strlcpy(t->name, name, sizeof t->name);
   t->stack = (uint8_t*)t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  t->tickets = t->eff_tickets = TICKETS_DEFAULT;
+  t->burst_avg = TIME_SLICE << BURST_SHIFT;
+  list_init(&t->held_locks);
+  if (t != initial_thread) {
+    /* Inherit the MLFQS parameters of the creating thread. */
+    struct thread* parent = running_thread();
+    t->nice = parent->nice;
+    t->recent_cpu = parent->recent_cpu;
+    t->recent_cpu_second = parent->recent_cpu_second;
+    t->vruntime = fair_min_vruntime;
+    t->pass = stride_min_pass;
+    if (active_sched_policy == SCHED_MLFQS)
+      t->priority = mlfqs_priority(t);
+  }
   t->pcb = NULL;
   t->magic = THREAD_MAGIC;
 
@@ -495,27 +1571,217 @@ static void* alloc_frame(struct thread* t, size_t size) {
 
 /* First-in first-out scheduler */
 static struct thread* thread_schedule_fifo(void) {
-  if (!list_empty(&fifo_ready_list))
-    return list_entry(list_pop_front(&fifo_ready_list), struct thread, elem);
-  else
-    return idle_thread;
+  struct runqueue* rq = this_runqueue();
+
+  if (!list_empty(&rq->fifo_ready_list)) {
+    rq->ready_cnt--;
+    return list_entry(list_pop_front(&rq->fifo_ready_list), struct thread, elem);
+  } else
+    return NULL;
+}
+
+/* Returns the index of the most significant set bit in X, which
+   must be nonzero.  BSR only scans 32 bits, so pick the half
+   first. */
+static inline int bit_scan_reverse(uint64_t x) {
+  uint32_t hi = x >> 32;
+  uint32_t lo = x;
+  uint32_t idx;
+
+  ASSERT(x != 0);
+  if (hi != 0) {
+    asm("bsrl %1, %0" : "=r"(idx) : "rm"(hi));
+    return idx + 32;
+  }
+  asm("bsrl %1, %0" : "=r"(idx) : "rm"(lo));
+  return idx;
+}
+
+/* Returns true if the active scheduling policy keeps its ready
+   threads in the per-priority ready queues. */
+static bool prio_queues_active(void) {
+  return active_sched_policy == SCHED_PRIO || active_sched_policy == SCHED_MLFQS;
+}
+
+/* Returns true if the active scheduling policy keeps its ready
+   threads on the per-CPU run queues. */
+static bool runqueues_active(void) {
+  return active_sched_policy == SCHED_FIFO || prio_queues_active();
+}
+
+/* Returns the running CPU's run queue. */
+static struct runqueue* this_runqueue(void) { return &runqueues[cpu_current()->id]; }
+
+/* Adds T to run queue RQ, in the structure used by the active
+   scheduling policy.  With adaptive slices, an interactive thread
+   being woken goes to the front of its queue. */
+static void runqueue_push(struct runqueue* rq, struct thread* t) {
+  bool front = t->status == THREAD_BLOCKED && thread_adaptive_slice && is_interactive(t);
+
+  if (active_sched_policy == SCHED_FIFO) {
+    if (front)
+      list_push_front(&rq->fifo_ready_list, &t->elem);
+    else
+      list_push_back(&rq->fifo_ready_list, &t->elem);
+    rq->ready_cnt++;
+  } else {
+    if (active_sched_policy == SCHED_MLFQS) {
+      mlfqs_catch_up(t);
+      t->priority = mlfqs_priority(t);
+    }
+    prio_queue_push(rq, t);
+    if (front) {
+      list_remove(&t->elem);
+      list_push_front(&rq->prio_ready_lists[t->priority], &t->elem);
+    }
+  }
+}
+
+/* Returns the priority of the highest-priority thread in RQ's
+   per-priority ready queues, or -1 if they are empty. */
+static int highest_ready_priority(const struct runqueue* rq) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  return rq->prio_ready_bitmap != 0 ? bit_scan_reverse(rq->prio_ready_bitmap) : -1;
+}
+
+/* Appends T to RQ's ready queue for its priority. */
+static void prio_queue_push(struct runqueue* rq, struct thread* t) {
+  list_push_back(&rq->prio_ready_lists[t->priority], &t->elem);
+  rq->prio_ready_bitmap |= (uint64_t)1 << t->priority;
+  rq->ready_cnt++;
+  t->rq = rq;
+}
+
+/* Removes ready thread T from the ready queue for its priority. */
+static void prio_queue_remove(struct thread* t) {
+  struct runqueue* rq = t->rq;
+
+  list_remove(&t->elem);
+  if (list_empty(&rq->prio_ready_lists[t->priority]))
+    rq->prio_ready_bitmap &= ~((uint64_t)1 << t->priority);
+  rq->ready_cnt--;
+  t->rq = NULL;
+}
+
+/* Removes and returns the first thread in RQ's highest-priority
+   nonempty ready queue, which must exist. */
+static struct thread* prio_queue_pop(struct runqueue* rq) {
+  int pri = highest_ready_priority(rq);
+  struct thread* t;
+
+  ASSERT(pri >= 0);
+  t = list_entry(list_front(&rq->prio_ready_lists[pri]), struct thread, elem);
+  prio_queue_remove(t);
+  return t;
 }
 
 /* Strict priority scheduler */
 static struct thread* thread_schedule_prio(void) {
-  PANIC("Unimplemented scheduler policy: \"-sched=prio\"");
+  struct runqueue* rq = this_runqueue();
+
+  return rq->prio_ready_bitmap != 0 ? prio_queue_pop(rq) : NULL;
+}
+
+/* Returns the run queue, other than RQ, with the most ready
+   threads, or a null pointer if every other one is empty. */
+static struct runqueue* busiest_runqueue(const struct runqueue* rq) {
+  struct runqueue* busiest = NULL;
+
+  for (int i = 0; i < CPU_MAX; i++)
+    if (&runqueues[i] != rq && runqueues[i].ready_cnt > 0
+        && (busiest == NULL || runqueues[i].ready_cnt > busiest->ready_cnt))
+      busiest = &runqueues[i];
+  return busiest;
+}
+
+/* Moves up to CNT threads from run queue FROM to RQ and returns
+   the number moved.  Threads come off the back of FROM, which
+   they joined most recently and where they would otherwise wait
+   longest, and under the priority schedulers from its
+   highest-priority queue, so that the threads that most need a
+   CPU get one. */
+static int runqueue_pull(struct runqueue* rq, struct runqueue* from, int cnt) {
+  int moved;
+
+  for (moved = 0; moved < cnt && from->ready_cnt > 0; moved++) {
+    struct thread* t;
+
+    if (active_sched_policy == SCHED_FIFO) {
+      t = list_entry(list_pop_back(&from->fifo_ready_list), struct thread, elem);
+      from->ready_cnt--;
+    } else {
+      int pri = highest_ready_priority(from);
+      t = list_entry(list_back(&from->prio_ready_lists[pri]), struct thread, elem);
+      prio_queue_remove(t);
+    }
+    runqueue_push(rq, t);
+  }
+  rq->taken += moved;
+  return moved;
 }
 
-/* Fair priority scheduler */
+/* Called when RQ, the running CPU's run queue, is empty: steals
+   half of the threads from the busiest other run queue. */
+static void runqueue_steal(struct runqueue* rq) {
+  struct runqueue* busiest = busiest_runqueue(rq);
+
+  if (busiest != NULL && runqueue_pull(rq, busiest, (busiest->ready_cnt + 1) / 2) > 0)
+    rq->steals++;
+}
+
+/* Periodic load balancing for CPU C, called from the timer
+   interrupt.  Counting the thread each CPU is running, evens out
+   the load between C and the busiest other CPU if they differ by
+   2 or more, then preempts C's running thread if it is no longer
+   the best choice. */
+static void runqueue_balance(struct cpu* c) {
+  struct runqueue* rq = &runqueues[c->id];
+  struct runqueue* busiest = busiest_runqueue(rq);
+  int load, busiest_load;
+
+  if (busiest == NULL)
+    return;
+  load = rq->ready_cnt + (c->cur != c->idle_thread);
+  busiest_load = busiest->ready_cnt + 1;
+  if (busiest_load - load >= 2 && runqueue_pull(rq, busiest, (busiest_load - load) / 2) > 0) {
+    rq->pulls++;
+    thread_check_preemption();
+  }
+}
+
+/* Weighted fair scheduler.  Runs the ready thread with the least
+   vruntime, which is the leftmost element of the ready tree, in
+   O(log n) time. */
 static struct thread* thread_schedule_fair(void) {
-  PANIC("Unimplemented scheduler policy: \"-sched=fair\"");
+  struct thread* t = fair_leftmost();
+
+  if (t == NULL)
+    return NULL;
+  rb_remove(&fair_ready_tree, &t->rbelem);
+  if (t->vruntime > fair_min_vruntime)
+    fair_min_vruntime = t->vruntime;
+  return t;
 }
 
-/* Multi-level feedback queue scheduler */
-static struct thread* thread_schedule_mlfqs(void) {
-  PANIC("Unimplemented scheduler policy: \"-sched=mlfqs\"");
+/* Stride scheduler.  Runs the ready thread with the smallest
+   pass, which is the leftmost element of the ready tree. */
+static struct thread* thread_schedule_stride(void) {
+  struct thread* t = stride_leftmost();
+
+  if (t == NULL)
+    return NULL;
+  rb_remove(&stride_ready_tree, &t->rbelem);
+  if (t->pass > stride_min_pass)
+    stride_min_pass = t->pass;
+  return t;
 }
 
+/* Multi-level feedback queue scheduler.  Priorities are kept
+   current by mlfqs_tick(), so picking a thread works exactly as
+   for the strict-priority scheduler. */
+static struct thread* thread_schedule_mlfqs(void) { return thread_schedule_prio(); }
+
 /* Not an actual scheduling policy — placeholder for empty
  * slots in the scheduler jump table. */
 static struct thread* thread_schedule_reserved(void) {
@@ -526,9 +1792,28 @@ static struct thread* thread_schedule_reserved(void) {
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   this CPU's idle thread.  Ready real-time threads come first,
+   earliest deadline first.  Threads of a throttled CPU group are
+   skipped. */
 static struct thread* next_thread_to_run(void) {
-  return (scheduler_jump_table[active_sched_policy])();
+  struct thread* t;
+
+  if (!list_empty(&rt_ready_list))
+    return list_entry(list_pop_front(&rt_ready_list), struct thread, elem);
+  if (cpu_cnt > 1 && runqueues_active() && this_runqueue()->ready_cnt == 0)
+    runqueue_steal(this_runqueue());
+  for (;;) {
+    t = (scheduler_jump_table[active_sched_policy])();
+    if (t == NULL)
+      return cpu_current()->idle_thread;
+#ifdef USERPROG
+    /* Threads of a throttled CPU group wait for its next
+       period. */
+    if (cpu_group_park(t))
+      continue;
+#endif
+    return t;
+  }
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -555,8 +1840,20 @@ void thread_switch_tail(struct thread* prev) {
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
 
+  /* Charge the time we spent waiting to run. */
+  if (!is_idle_thread(cur)) {
+    uint64_t waited = clock_ns() - cur->ready_since;
+    cur->ready_ns += waited;
+    if (cur->woken) {
+      wakeup_latency[latency_bucket(waited)]++;
+      cur->woken = false;
+    }
+  }
+
   /* Start new time slice. */
-  thread_ticks = 0;
+  cur->cpu->cur = cur;
+  cur->cpu->thread_ticks = 0;
+  cur->cpu->slice = slice_length();
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -570,8 +1867,71 @@ void thread_switch_tail(struct thread* prev) {
      palloc().) */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) {
     ASSERT(prev != cur);
-    palloc_free_page(prev);
+    thread_page_free(prev);
+  }
+}
+
+/* Returns a page for a new thread, from the thread cache if it
+   is nonempty, otherwise a fresh page from palloc, or a null
+   pointer if none is available.  Only the struct thread at the
+   start of the page is guaranteed to be zeroed. */
+static struct thread* thread_page_alloc(void) {
+  enum intr_level old_level = intr_disable();
+  struct cached_page* p = thread_cache;
+
+  if (p != NULL) {
+    thread_cache = p->next;
+    thread_cache_cnt--;
+    thread_cache_hits++;
+  } else
+    thread_cache_misses++;
+  intr_set_level(old_level);
+
+  if (p == NULL)
+    return palloc_get_page(PAL_ZERO);
+  memset(p, 0, sizeof(struct thread));
+  return (struct thread*)p;
+}
+
+/* Releases the page of dying thread T, keeping it in the thread
+   cache unless that is full.  Must be called with interrupts
+   off. */
+static void thread_page_free(struct thread* t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (thread_cache_cnt < thread_cache_limit) {
+    struct cached_page* p = (struct cached_page*)t;
+    p->next = thread_cache;
+    thread_cache = p;
+    thread_cache_cnt++;
+  } else
+    palloc_free_page(t);
+}
+
+/* Sets the maximum number of dead thread pages kept for reuse to
+   LIMIT, releasing any cached pages beyond it.  0 disables the
+   cache.  Controlled by the kernel command-line option
+   "-thread-cache". */
+void thread_set_cache_limit(size_t limit) {
+  enum intr_level old_level = intr_disable();
+
+  thread_cache_limit = limit;
+  while (thread_cache_cnt > limit) {
+    struct cached_page* p = thread_cache;
+    thread_cache = p->next;
+    thread_cache_cnt--;
+    palloc_free_page(p);
   }
+  intr_set_level(old_level);
+}
+
+/* Returns the number of thread_create() calls that reused a
+   cached thread page since boot. */
+long long thread_get_cache_hits(void) {
+  enum intr_level old_level = intr_disable();
+  long long t = thread_cache_hits;
+  intr_set_level(old_level);
+  return t;
 }
 
 /* Schedules a new thread.  At entry, interrupts must be off and
@@ -589,24 +1949,79 @@ static void schedule(void) {
   ASSERT(intr_get_level() == INTR_OFF);
   ASSERT(cur->status != THREAD_RUNNING);
   ASSERT(is_thread(next));
-
-  if (cur != next)
+  ASSERT(cur->rcu_nesting == 0);
+
+  /* No thread on this CPU is inside an RCU reader now. */
+  cur->cpu->rcu_qs++;
+
+  if (cur != next) {
+    /* Average the ticks run before blocking or being preempted,
+       weighting the latest burst 1/4. */
+    if (cur->status == THREAD_BLOCKED || cur->status == THREAD_READY)
+      cur->burst_avg = (cur->burst_avg * 3 + ((int) cur->cpu->thread_ticks << BURST_SHIFT)) / 4;
+    if (cur->status == THREAD_BLOCKED) {
+      cur->voluntary_switches++;
+      sched_trace(SCHED_EV_BLOCK, cur, 0);
+    } else if (cur->status == THREAD_READY)
+      cur->involuntary_switches++;
+    sched_trace(SCHED_EV_SWITCH_OUT, cur, cur->status);
+    sched_trace(SCHED_EV_SWITCH_IN, next, next->priority);
+    if (next->cpu != NULL && next->cpu != cur->cpu)
+      migrations++;
+    next->cpu = cur->cpu;
     prev = switch_threads(cur, next);
+  }
   thread_switch_tail(prev);
 }
 
-/* Returns a tid to use for a new thread. */
+/* Returns the wakeup_latency bucket for a latency of NS
+   nanoseconds. */
+static int latency_bucket(uint64_t ns) {
+  uint64_t us = ns / 1000;
+  int b;
+
+  if (us < 2)
+    return 0;
+  b = bit_scan_reverse(us);
+  return b < LATENCY_BUCKETS ? b : LATENCY_BUCKETS - 1;
+}
+
+/* Returns a tid to use for a new thread, from the running CPU's
+   batch.  Turns interrupts off on this CPU only, which keeps the
+   running thread on this CPU and the batch to itself, but does
+   not take the kernel lock.  Other CPUs may refill their batches
+   at the same time, so refilling is atomic. */
 static tid_t allocate_tid(void) {
-  static tid_t next_tid = 1;
+  enum intr_level old_level = intr_local_disable();
+  struct tid_batch* b = &tid_batches[cpu_current()->id];
   tid_t tid;
 
-  lock_acquire(&tid_lock);
-  tid = next_tid++;
-  lock_release(&tid_lock);
-
+  if (b->next == b->end) {
+    b->next = atomic_fetch_add(&next_tid_batch, TID_BATCH);
+    if (b->next <= 0 || b->next > INT_MAX - TID_BATCH)
+      PANIC("out of thread identifiers");
+    b->end = b->next + TID_BATCH;
+  }
+  tid = b->next++;
+  intr_local_restore(old_level);
   return tid;
 }
 
+/* Gives T a new TID and adds it to the TID hash table.  Returns
+   the TID. */
+static tid_t register_tid(struct thread* t) {
+  enum intr_level old_level;
+
+  t->tid = allocate_tid();
+  old_level = intr_disable();
+  list_push_back(tid_bucket(t->tid), &t->tidelem);
+  intr_set_level(old_level);
+  return t->tid;
+}
+
+/* Returns the TID hash table bucket for TID. */
+static struct list* tid_bucket(tid_t tid) { return &tid_buckets[tid & (TID_BUCKETS - 1)]; }
+
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof(struct thread, stack);
\ No newline at end of file
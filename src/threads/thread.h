@@ -8,6 +8,7 @@
 #include "threads/synch.h"
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
 
 /* States in a thread's life cycle. */
@@ -19,7 +20,18 @@ enum thread_status {
 };
 
 /* Thread identifier type.
-   You can redefine this to whatever type you like. */
+
+   TIDs are positive and are never reused: once a thread exits,
+   no later thread is given its TID, so a stale TID can never name
+   a different thread, and get_thread_by_tid() simply returns a
+   null pointer for it.  The kernel panics rather than wrap around
+   after INT_MAX TIDs.
+
+   Each CPU hands out TIDs from its own batch of consecutive TIDs
+   (see allocate_tid() in thread.c), so TIDs are unique but not
+   dense, and TIDs of threads created on different CPUs do not
+   reflect the order in which they were created.  On one CPU they
+   increase with creation order. */
 typedef int tid_t;
 #define TID_ERROR ((tid_t)-1) /* Error value for tid_t. */
 
@@ -28,6 +40,28 @@ typedef int tid_t;
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX 63     /* Highest priority. */
 
+/* Thread nice values. */
+#define NICE_MIN -20    /* Nicest. */
+#define NICE_DEFAULT 0  /* Default nice value. */
+#define NICE_MAX 20     /* Least nice. */
+
+/* Stride scheduler tickets.  Under SCHED_STRIDE, each thread
+   receives CPU time in proportion to its share of the tickets of
+   all ready and running threads. */
+#define TICKETS_MIN 1       /* Fewest tickets. */
+#define TICKETS_DEFAULT 100 /* Default number of tickets. */
+#define TICKETS_MAX 10000   /* Most tickets. */
+
+/* Real-time utilization is measured in millionths of the CPU.
+   thread_set_realtime() admits a thread only if the utilizations
+   budget / period of all real-time threads add up to at most
+   RT_UTIL_SCALE. */
+#define RT_UTIL_SCALE 1000000
+
+/* Maximum length of a chain of lock holders that a priority
+   donation propagates through. */
+#define PRI_DONATION_DEPTH 8
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -80,23 +114,63 @@ typedef int tid_t;
    value, triggering the assertion. */
 /* The `elem` member has a dual purpose. It can be an element in
    the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c). It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   semaphore wait list (synch.c) or the sleep queue (timer.c).
+   It can be used these ways only because they are mutually
+   exclusive: only a thread in the ready state is on the run
+   queue, whereas only a blocked thread is on a semaphore wait
+   list or sleeping in timer_sleep(). */
 struct thread {
   /* Owned by thread.c. */
   tid_t tid;                 /* Thread identifier. */
   enum thread_status status; /* Thread state. */
   char name[16];             /* Name (for debugging purposes). */
   uint8_t* stack;            /* Saved stack pointer. */
-  int priority;              /* Priority. */
+  int priority;              /* Effective priority, including donations. */
+  int base_priority;         /* Priority set by thread_set_priority(). */
+  int nice;                  /* MLFQS niceness. */
+  fixed_point_t recent_cpu;  /* MLFQS recent CPU usage. */
+  int64_t recent_cpu_second; /* Last second recent_cpu was decayed. */
+  int64_t vruntime;          /* Fair scheduler weighted virtual runtime. */
+  struct rb_elem rbelem;     /* Fair or stride scheduler ready tree element. */
+  int tickets;               /* Stride tickets set by thread_set_tickets(). */
+  int eff_tickets;           /* Stride tickets, including transfers. */
+  int64_t pass;              /* Stride scheduler virtual time. */
+  int64_t rt_period;         /* Real-time period in ticks, 0 if not real-time. */
+  int64_t rt_budget;         /* Real-time CPU budget per period, in ticks. */
+  int64_t rt_deadline;       /* Tick at which the current period ends. */
+  int64_t rt_remaining;      /* Budget left in the current period. */
+  bool rt_throttled;         /* Budget exhausted until rt_deadline? */
+  bool rt_job_done;          /* Finished the current period's work? */
+  int rt_misses;             /* Number of deadlines missed. */
+  struct cpu* cpu;           /* CPU it last ran on, or NULL if never run. */
+  struct runqueue* rq;       /* Run queue it is ready on, if any. */
   struct list_elem allelem;  /* List element for all threads list. */
+  struct list_elem tidelem;  /* List element for TID hash table. */
+
+  /* CPU accounting, owned by thread.c. */
+  int64_t user_ticks;           /* Timer ticks spent running user code. */
+  int64_t kernel_ticks;         /* Timer ticks spent running in the kernel. */
+  int64_t voluntary_switches;   /* Switched out because it blocked. */
+  int64_t involuntary_switches; /* Switched out while still ready to run. */
+  uint64_t ready_ns;            /* Total time spent ready but not running. */
+  uint64_t ready_since;         /* clock_ns() when it last became ready. */
+  bool woken;                   /* Made ready by thread_unblock()? */
+  int burst_avg;                /* Average ticks run before blocking, fixed point. */
 
   /* Shared between thread.c and synch.c. */
-  struct list_elem elem;    /* List element. */
+  struct list_elem elem;     /* List element. */
+  struct list held_locks;    /* Locks held, for priority donation. */
+  struct lock* waiting_lock; /* Lock being acquired, or NULL. */
+  struct lock* morph_lock;   /* Lock to be handed over by wait morphing. */
+  uint64_t morph_since;      /* lockstat_now() when moved onto its queue. */
+  int rcu_nesting;           /* Depth of RCU read-side critical sections. */
+  bool rcu_yield_pending;    /* Preempted while in one? */
   bool process_exit_called; // Flag to indicate if process_exit() was called
 
+  /* Owned by devices/timer.c. */
+  int64_t wake_tick; /* Tick at which a sleeping thread wakes up. */
+  uint64_t wake_ns;  /* clock_ns() time for a high-resolution sleep. */
+
 #ifdef USERPROG
   /* Owned by process.c. */
   struct process*
@@ -132,6 +206,7 @@ enum sched_policy {
   SCHED_PRIO,  // Strict-priority scheduler with round-robin tiebreaking
   SCHED_FAIR,  // Implementation-defined fair scheduler
   SCHED_MLFQS, // Multi-level Feedback Queue Scheduler
+  SCHED_STRIDE, // Proportional-share stride scheduler
 };
 #define SCHED_DEFAULT SCHED_FIFO
 
@@ -141,11 +216,24 @@ enum sched_policy {
  * Is equal to SCHED_FIFO by default. */
 extern enum sched_policy active_sched_policy;
 
+/* If true (the default), time slices adapt to run queue length
+   and interactivity; if false, every slice is the same length.
+   Controlled by kernel command-line option "-slice". */
+extern bool thread_adaptive_slice;
+
 void thread_init(void);
 void thread_start(void);
+void* thread_create_idle(struct cpu*);
+void thread_start_ap(void) NO_RETURN;
 
-void thread_tick(void);
+void thread_tick(bool user);
 void thread_print_stats(void);
+long long thread_get_idle_ticks(void);
+long long thread_get_idle_wakeups(void);
+long long thread_get_migrations(void);
+long long thread_get_steals(void);
+void thread_set_cache_limit(size_t);
+long long thread_get_cache_hits(void);
 
 typedef void thread_func(void* aux);
 tid_t thread_create(const char* name, int priority, thread_func*, void*);
@@ -159,6 +247,8 @@ const char* thread_name(void);
 
 void thread_exit(void) NO_RETURN;
 void thread_yield(void);
+void thread_check_preemption(void);
+bool thread_priority_less(const struct list_elem*, const struct list_elem*, void* aux);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func(struct thread* t, void* aux);
@@ -166,6 +256,20 @@ void thread_foreach(thread_action_func*, void*);
 
 int thread_get_priority(void);
 void thread_set_priority(int);
+void thread_donate_priority(struct thread*, int priority);
+void thread_update_priority(struct thread*);
+
+/* Earliest-deadline-first real-time scheduling. */
+bool thread_set_realtime(int64_t period, int64_t budget);
+void thread_clear_realtime(void);
+void thread_wait_period(void);
+int thread_get_deadline_misses(void);
+int64_t thread_rt_next_release(void);
+
+int thread_get_tickets(void);
+void thread_set_tickets(int);
+void thread_transfer_tickets(struct thread*);
+void thread_update_tickets(struct thread*);
 
 int thread_get_nice(void);
 void thread_set_nice(int);
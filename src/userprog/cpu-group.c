@@ -0,0 +1,153 @@
+#include "userprog/cpu-group.h"
+#include "userprog/process.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include <debug.h>
+#include <stdio.h>
+
+/* CPU bandwidth quotas for groups of processes.
+
+   thread_tick() charges each tick to the group of the running
+   thread's process, if it has one.  When a group's usage for the
+   period reaches its quota, the group is throttled and the
+   running thread yields.  From then until the period ends,
+   next_thread_to_run() parks every thread of the group that it
+   picks, instead of running it, on the group's parked list, and
+   threads of the group running on other CPUs yield at their next
+   tick.  At the end of the period, cpu_group_release() starts a
+   new period and makes the parked threads ready again.
+
+   Groups are never destroyed, so that their usage can still be
+   read after all of their processes have exited.  The group table
+   is protected by disabling interrupts. */
+
+static struct cpu_group groups[CPU_GROUP_MAX];
+static int group_cnt;
+
+/* Returns the group of the process that T belongs to, or a null
+   pointer if T is not a user process or its process is not in a
+   group. */
+static struct cpu_group* thread_group(struct thread* t) {
+  return t->pcb != NULL ? t->pcb->cpu_group : NULL;
+}
+
+/* Creates a new group with no quota.  Returns the new group, or a
+   null pointer if CPU_GROUP_MAX groups already exist. */
+struct cpu_group* cpu_group_create(void) {
+  enum intr_level old_level = intr_disable();
+  struct cpu_group* g = NULL;
+
+  if (group_cnt < CPU_GROUP_MAX) {
+    g = &groups[group_cnt++];
+    g->id = group_cnt;
+    g->period = TIMER_FREQ;
+    g->period_end = timer_ticks() + g->period;
+    list_init(&g->parked);
+  }
+  intr_set_level(old_level);
+  return g;
+}
+
+/* Returns the group with the given ID, or a null pointer if there
+   is none. */
+struct cpu_group* cpu_group_lookup(int id) {
+  enum intr_level old_level = intr_disable();
+  struct cpu_group* g = id >= 1 && id <= group_cnt ? &groups[id - 1] : NULL;
+  intr_set_level(old_level);
+  return g;
+}
+
+/* Limits group G to QUOTA ticks of CPU time in every PERIOD
+   ticks, starting with a new period now.  A QUOTA of 0 removes
+   the limit.  Returns false, leaving G unchanged, if PERIOD is
+   not positive or QUOTA is not between 0 and PERIOD. */
+bool cpu_group_set_quota(struct cpu_group* g, int64_t quota, int64_t period) {
+  enum intr_level old_level;
+
+  if (period <= 0 || quota < 0 || quota > period)
+    return false;
+
+  old_level = intr_disable();
+  g->quota = quota;
+  g->period = period;
+  g->period_end = timer_ticks() + period;
+  g->used = 0;
+  intr_set_level(old_level);
+
+  /* Let anything parked under the old quota run again. */
+  cpu_group_release();
+  return true;
+}
+
+/* Charges the current timer tick, spent running thread T, to T's
+   group, and makes T yield if the group is, or has just become,
+   throttled.  Called by thread_tick() in the timer interrupt. */
+void cpu_group_tick(struct thread* t) {
+  struct cpu_group* g = thread_group(t);
+
+  ASSERT(intr_context());
+
+  if (g == NULL)
+    return;
+  g->used++;
+  g->total++;
+  if (g->quota != 0 && g->used >= g->quota && !g->throttled) {
+    g->throttled = true;
+    g->throttle_cnt++;
+  }
+  if (g->throttled)
+    intr_yield_on_return();
+}
+
+/* Called by next_thread_to_run() with T, a thread it has just
+   taken off the ready queues.  If T's group is throttled, parks T
+   until the group's next period and returns true; otherwise
+   returns false and T may run. */
+bool cpu_group_park(struct thread* t) {
+  struct cpu_group* g = thread_group(t);
+
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (g == NULL || !g->throttled)
+    return false;
+  t->status = THREAD_BLOCKED;
+  list_push_back(&g->parked, &t->elem);
+  return true;
+}
+
+/* Starts a new period for each group whose period has ended, or
+   whose quota has been lifted, and makes its parked threads ready
+   to run.  Called by the boot CPU's thread_tick() once per tick. */
+void cpu_group_release(void) {
+  enum intr_level old_level = intr_disable();
+  int64_t now = timer_ticks();
+
+  for (int i = 0; i < group_cnt; i++) {
+    struct cpu_group* g = &groups[i];
+
+    if (now >= g->period_end) {
+      g->used = 0;
+      g->period_end = now + g->period;
+    }
+    if (g->throttled && (g->quota == 0 || g->used < g->quota)) {
+      g->throttled = false;
+      while (!list_empty(&g->parked))
+        thread_unblock(list_entry(list_pop_front(&g->parked), struct thread, elem));
+    }
+  }
+  intr_set_level(old_level);
+}
+
+/* Prints the usage of each group. */
+void cpu_group_print_stats(void) {
+  for (int i = 0; i < group_cnt; i++) {
+    struct cpu_group* g = &groups[i];
+
+    printf("CPU group %d: %lld ticks used", g->id, (long long)g->total);
+    if (g->quota != 0)
+      printf(", quota %lld/%lld ticks, throttled %lld times", (long long)g->quota,
+             (long long)g->period, (long long)g->throttle_cnt);
+    printf("\n");
+  }
+}
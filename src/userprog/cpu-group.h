@@ -0,0 +1,40 @@
+#ifndef USERPROG_CPU_GROUP_H
+#define USERPROG_CPU_GROUP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* Maximum number of CPU groups. */
+#define CPU_GROUP_MAX 16
+
+/* A CPU group: a set of processes whose threads together may run
+   for at most QUOTA timer ticks in every PERIOD ticks.  Once the
+   group has used its quota, all of its threads are throttled
+   until the period ends.  Each process belongs to at most one
+   group, recorded in its struct process, and a process started by
+   exec() joins its parent's group. */
+struct cpu_group {
+  int id;                /* Group identifier, from 1 up. */
+  int64_t quota;         /* Ticks allowed per period, 0 for no limit. */
+  int64_t period;        /* Length of a period, in ticks. */
+  int64_t period_end;    /* Tick at which the current period ends. */
+  int64_t used;          /* Ticks used in the current period. */
+  int64_t total;         /* Ticks used since the group was created. */
+  int64_t throttle_cnt;  /* # of periods in which the quota ran out. */
+  bool throttled;        /* Quota used up until period_end? */
+  struct list parked;    /* Threads ready to run but throttled. */
+};
+
+struct cpu_group* cpu_group_create(void);
+struct cpu_group* cpu_group_lookup(int id);
+bool cpu_group_set_quota(struct cpu_group*, int64_t quota, int64_t period);
+
+void cpu_group_tick(struct thread*);
+bool cpu_group_park(struct thread*);
+void cpu_group_release(void);
+void cpu_group_print_stats(void);
+
+#endif /* userprog/cpu-group.h */
@@ -0,0 +1,109 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Futexes: wait queues for user-space synchronization.
+
+   A user lock or semaphore (see lib/user/syscall.c) is a word in
+   user memory that threads update with atomic instructions, so
+   they only enter the kernel when one of them has to wait or
+   wake a waiter.  A thread that has to wait calls futex_wait()
+   with the word's address and the value it saw there, and sleeps
+   only if the word still holds that value, which closes the race
+   with a thread that changes the word and calls futex_wake() in
+   between.
+
+   Waiters are kept in a hash table of wait queues keyed by the
+   physical address of the word, so that it makes no difference
+   at which user address, or in which process, the word is
+   mapped.  Each waiter's entry lives on its kernel stack, so
+   waiting allocates nothing.  The table is protected by
+   disabling interrupts. */
+
+#define FUTEX_BUCKETS 64 /* Number of hash buckets; a power of 2. */
+
+/* A thread waiting in futex_wait(). */
+struct futex_waiter {
+  struct list_elem elem; /* Element in a bucket. */
+  uintptr_t key;         /* Physical address of the word. */
+  struct thread* thread; /* The waiting thread. */
+};
+
+static struct list buckets[FUTEX_BUCKETS];
+
+/* Initializes the futex hash table. */
+void futex_init(void) {
+  int i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    list_init(&buckets[i]);
+}
+
+/* Returns the kernel virtual address at which the running
+   process's word at UADDR is mapped.  The caller must have checked
+   that UADDR is a mapped, aligned user address. */
+static int* futex_kaddr(const int* uaddr) {
+  int* kaddr = pagedir_get_page(thread_current()->pcb->pagedir, uaddr);
+
+  ASSERT(kaddr != NULL);
+  return kaddr;
+}
+
+/* Returns the bucket for the word with physical address KEY. */
+static struct list* futex_bucket(uintptr_t key) {
+  return &buckets[(key / sizeof(int)) % FUTEX_BUCKETS];
+}
+
+/* If the word at user address UADDR holds VAL, blocks until
+   futex_wake() wakes the running thread and returns true.
+   Otherwise, returns false at once. */
+bool futex_wait(const int* uaddr, int val) {
+  int* kaddr = futex_kaddr(uaddr);
+  struct futex_waiter w;
+  enum intr_level old_level;
+  bool waited = false;
+
+  old_level = intr_disable();
+  if (*kaddr == val) {
+    w.key = vtop(kaddr);
+    w.thread = thread_current();
+    list_push_back(futex_bucket(w.key), &w.elem);
+    thread_block();
+    waited = true;
+  }
+  intr_set_level(old_level);
+  return waited;
+}
+
+/* Wakes up to N threads waiting on the word at user address
+   UADDR, in the order they began waiting, and returns the number
+   woken. */
+int futex_wake(const int* uaddr, int n) {
+  uintptr_t key = vtop(futex_kaddr(uaddr));
+  struct list* bucket = futex_bucket(key);
+  enum intr_level old_level;
+  struct list_elem* e;
+  int woken = 0;
+
+  old_level = intr_disable();
+  for (e = list_begin(bucket); e != list_end(bucket) && woken < n;) {
+    struct futex_waiter* w = list_entry(e, struct futex_waiter, elem);
+
+    if (w->key == key) {
+      e = list_remove(e);
+      thread_unblock(w->thread);
+      woken++;
+    } else
+      e = list_next(e);
+  }
+  intr_set_level(old_level);
+
+  thread_check_preemption();
+  return woken;
+}
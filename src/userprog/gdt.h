@@ -2,14 +2,19 @@
 #define USERPROG_GDT_H
 
 #include "threads/loader.h"
+#include "threads/smp.h"
 
 /* Segment selectors.
    More selectors are defined by the loader in loader.h. */
 #define SEL_UCSEG 0x1B /* User code selector. */
 #define SEL_UDSEG 0x23 /* User data selector. */
-#define SEL_TSS 0x28   /* Task-state segment. */
-#define SEL_CNT 6      /* Number of segments. */
+#define SEL_TSS 0x28   /* Task-state segment of CPU 0. */
+
+/* Number of segments.  Each CPU has a task-state segment of its
+   own, CPU N's at selector SEL_TSS + 8 * N. */
+#define SEL_CNT (5 + CPU_MAX)
 
 void gdt_init(void);
+void gdt_init_ap(int cpu_id);
 
 #endif /* userprog/gdt.h */
@@ -81,7 +81,7 @@ struct Elf32_Phdr {
 #define MAX_ARGS 128
 
 /* Function declarations */
-static void start_process(void* file_name_) NO_RETURN;
+static void start_process(void* cp_) NO_RETURN;
 static bool load(const char* cmdline, void (**eip)(void), void** esp,
                  char** argv, int argc);
 static bool setup_stack(void** esp, char** argv, int argc);
@@ -131,16 +131,9 @@ pid_t process_execute(const char* file_name) {
   /* Extract program name */
   program_name = strtok_r(file_name_copy, " ", &save_ptr);
 
-  /* Create a new thread to execute PROGRAM_NAME */
-  tid = thread_create(program_name, PRI_DEFAULT, start_process, fn_copy);
-  if (tid == TID_ERROR) {
-    palloc_free_page(fn_copy);
-    free(file_name_copy);
-    return TID_ERROR;
-  }
-
-  /* Add child process to the parent's child list */
-  struct thread* child_thread = get_thread_by_tid(tid);
+  /* Set up the child's entry in the child list before creating
+     it, since on a multiprocessor it may start running before
+     thread_create() returns. */
   struct child_process* cp = malloc(sizeof(struct child_process));
   if (cp == NULL) {
     palloc_free_page(fn_copy);
@@ -148,14 +141,24 @@ pid_t process_execute(const char* file_name) {
     return TID_ERROR;
   }
 
-  cp->pid = tid;
   cp->exit_status = -1;
   cp->waited = false;
+  cp->cmd_line = fn_copy;
+  cp->cpu_group = thread_current()->pcb->cpu_group;
   sema_init(&cp->sema_wait, 0);
   sema_init(&cp->load_sema, 0);
 
-  child_thread->cp = cp;
+  /* Create a new thread to execute PROGRAM_NAME */
+  tid = thread_create(program_name, PRI_DEFAULT, start_process, cp);
+  if (tid == TID_ERROR) {
+    palloc_free_page(fn_copy);
+    free(file_name_copy);
+    free(cp);
+    return TID_ERROR;
+  }
+  cp->pid = tid;
 
+  /* Add child process to the parent's child list */
   struct thread* cur = thread_current();
   lock_acquire(&cur->child_lock);
   list_push_back(&cur->child_list, &cp->elem);
@@ -209,8 +212,9 @@ static char* parse_command_line(const char* cmdline, int* argc, char*** argv) {
 }
 
 /* Modified start_process function */
-static void start_process(void* file_name_) {
-  char* file_name = (char*)file_name_;
+static void start_process(void* cp_) {
+  struct child_process* cp = cp_;
+  char* file_name = cp->cmd_line;
   struct thread* t = thread_current();
   struct intr_frame if_;
   bool success;
@@ -218,6 +222,8 @@ static void start_process(void* file_name_) {
   char** argv;
   char* cmdline_copy = NULL;
 
+  t->cp = cp;
+
   /* Parse command line into arguments */
   cmdline_copy = parse_command_line(file_name, &argc, &argv);
 
@@ -232,6 +238,9 @@ static void start_process(void* file_name_) {
   if (t->pcb == NULL)
     PANIC("Failed to allocate PCB.");
 
+  /* Join the parent's CPU group. */
+  t->pcb->cpu_group = cp->cpu_group;
+
   /* Initialize the file descriptor table */
   t->fd_table_size = 128; /* Set the desired size for the fd table */
   t->fd_table = malloc(sizeof(struct file*) * t->fd_table_size);
@@ -244,10 +253,8 @@ static void start_process(void* file_name_) {
   success = load(argv[0], &if_.eip, &if_.esp, argv, argc);
 
   /* Signal the parent process about load success */
-  if (t->cp != NULL) {
-    t->cp->load_success = success;
-    sema_up(&t->cp->load_sema);
-  }
+  cp->load_success = success;
+  sema_up(&cp->load_sema);
 
   /* Clean up resources */
   palloc_free_page(file_name);
@@ -361,9 +368,14 @@ void process_exit(void) {
       pagedir_destroy(pd);
     }
 
-    /* Free the PCB */
-    free(cur->pcb);
+    /* Free the PCB.  The timer interrupt and the scheduler read
+       the running thread's CPU group through it, so detach it
+       with interrupts off before freeing it. */
+    struct process* pcb = cur->pcb;
+    enum intr_level old_level = intr_disable();
     cur->pcb = NULL;
+    intr_set_level(old_level);
+    free(pcb);
   }
 }
 
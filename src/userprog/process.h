@@ -28,6 +28,8 @@ struct child_process {
   struct semaphore sema_wait; // Semaphore for parent to wait on child
   struct semaphore load_sema;
   bool load_success;
+  char* cmd_line; // Command line, until the child has loaded.
+  struct cpu_group* cpu_group; // CPU group the child starts in.
   struct list_elem elem; // List element for child list.
 };
 
@@ -42,6 +44,7 @@ struct process {
   char process_name[16];      /* Name of the main thread */
   struct thread* main_thread; /* Pointer to main thread */
   struct list child_processes; 
+  struct cpu_group* cpu_group; /* CPU group, or NULL if none. */
 };
 
 void userprog_init(void);
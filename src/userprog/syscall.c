@@ -11,6 +11,8 @@
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/cpu-group.h"
+#include "userprog/futex.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
 #include <stdio.h>
@@ -39,11 +41,18 @@ static void sys_seek(int fd, unsigned position);
 static unsigned sys_tell(int fd);
 static void sys_close(int fd);
 static struct file* get_file(int fd);
+static int sys_cg_create(void);
+static bool sys_cg_set_quota(int group, int quota, int period);
+static bool sys_cg_join(int group);
+static int sys_cg_usage(int group);
+static bool sys_futex_wait(const int* uaddr, int val);
+static int sys_futex_wake(const int* uaddr, int n);
 
 static struct lock filesys_lock; // Lock for synchronizing file system access
 
 void syscall_init(void) {
   lock_init(&filesys_lock);
+  futex_init();
   intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -130,6 +139,43 @@ static void syscall_handler(struct intr_frame* f) {
     f->eax = sys_practice((int)args[1]);
     break;
 
+  case SYS_CG_CREATE:
+    f->eax = sys_cg_create();
+    break;
+
+  case SYS_CG_SET_QUOTA:
+    check_pointer_valid(args + 1);
+    check_pointer_valid(args + 2);
+    check_pointer_valid(args + 3);
+    f->eax = sys_cg_set_quota((int)args[1], (int)args[2], (int)args[3]);
+    break;
+
+  case SYS_CG_JOIN:
+    check_pointer_valid(args + 1);
+    f->eax = sys_cg_join((int)args[1]);
+    break;
+
+  case SYS_CG_USAGE:
+    check_pointer_valid(args + 1);
+    f->eax = sys_cg_usage((int)args[1]);
+    break;
+
+  case SYS_GET_TID:
+    f->eax = thread_current()->tid;
+    break;
+
+  case SYS_FUTEX_WAIT:
+    check_pointer_valid(args + 1);
+    check_pointer_valid(args + 2);
+    f->eax = sys_futex_wait((const int*)args[1], (int)args[2]);
+    break;
+
+  case SYS_FUTEX_WAKE:
+    check_pointer_valid(args + 1);
+    check_pointer_valid(args + 2);
+    f->eax = sys_futex_wake((const int*)args[1], (int)args[2]);
+    break;
+
   default:
     printf("Unknown syscall number: %d\n", syscall_number);
     sys_exit(-1);
@@ -350,4 +396,66 @@ static struct file* get_file(int fd) {
     return NULL;
 
   return cur->fd_table[fd];
-}
\ No newline at end of file
+}
+
+/* Creates a CPU group with no quota and returns its ID, or -1 if
+   no more groups can be created. */
+static int sys_cg_create(void) {
+  struct cpu_group* g = cpu_group_create();
+  return g != NULL ? g->id : -1;
+}
+
+/* Limits CPU group GROUP to QUOTA ticks in every PERIOD ticks. */
+static bool sys_cg_set_quota(int group, int quota, int period) {
+  struct cpu_group* g = cpu_group_lookup(group);
+  return g != NULL && cpu_group_set_quota(g, quota, period);
+}
+
+/* Moves the current process into CPU group GROUP, or out of any
+   group if GROUP is 0.  Processes it starts afterward inherit the
+   group. */
+static bool sys_cg_join(int group) {
+  struct cpu_group* g = NULL;
+  enum intr_level old_level;
+
+  if (group != 0 && (g = cpu_group_lookup(group)) == NULL)
+    return false;
+  old_level = intr_disable();
+  thread_current()->pcb->cpu_group = g;
+  intr_set_level(old_level);
+  return true;
+}
+
+/* Returns the number of ticks CPU group GROUP has used since it
+   was created, or -1 if there is no such group. */
+static int sys_cg_usage(int group) {
+  struct cpu_group* g = cpu_group_lookup(group);
+  enum intr_level old_level;
+  int usage;
+
+  if (g == NULL)
+    return -1;
+  old_level = intr_disable();
+  usage = g->total;
+  intr_set_level(old_level);
+  return usage;
+}
+
+/* Sleeps until woken by sys_futex_wake() if the word at UADDR
+   holds VAL.  Returns false without sleeping if it does not.  The
+   word must be aligned, so that it lies within one page. */
+static bool sys_futex_wait(const int* uaddr, int val) {
+  if ((uintptr_t)uaddr % sizeof(int) != 0)
+    sys_exit(-1);
+  check_pointer_valid(uaddr);
+  return futex_wait(uaddr, val);
+}
+
+/* Wakes up to N threads sleeping on the word at UADDR and returns
+   the number woken. */
+static int sys_futex_wake(const int* uaddr, int n) {
+  if ((uintptr_t)uaddr % sizeof(int) != 0)
+    sys_exit(-1);
+  check_pointer_valid(uaddr);
+  return futex_wake(uaddr, n);
+}
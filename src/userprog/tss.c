@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/vaddr.h"
 
 /* The Task-State Segment (TSS).
@@ -44,6 +45,9 @@
        stack pointer to point to the new thread's kernel stack.
        (The call is in thread_schedule_tail() in thread.c.)
 
+   Each CPU switches stacks through its own TSS, so there is one
+   per CPU.
+
    See [IA32-v3a] 6.2.1 "Task-State Segment (TSS)" for a
    description of the TSS.  See [IA32-v3a] 5.12.1 "Exception- or
    Interrupt-Handler Procedures" for a description of when and
@@ -71,29 +75,35 @@ struct tss {
   uint16_t trace, bitmap;
 };
 
-/* Kernel TSS. */
+/* Kernel TSSes, indexed by CPU.  All of them fit in one page. */
 static struct tss* tss;
 
-/* Initializes the kernel TSS. */
+/* Initializes the kernel TSSes. */
 void tss_init(void) {
+  int i;
+
   /* Our TSS is never used in a call gate or task gate, so only a
      few fields of it are ever referenced, and those are the only
      ones we initialize. */
+  ASSERT(CPU_MAX * sizeof *tss <= PGSIZE);
   tss = palloc_get_page(PAL_ASSERT | PAL_ZERO);
-  tss->ss0 = SEL_KDSEG;
-  tss->bitmap = 0xdfff;
+  for (i = 0; i < CPU_MAX; i++) {
+    tss[i].ss0 = SEL_KDSEG;
+    tss[i].bitmap = 0xdfff;
+  }
   tss_update();
 }
 
-/* Returns the kernel TSS. */
-struct tss* tss_get(void) {
+/* Returns the kernel TSS of CPU_ID. */
+struct tss* tss_get(int cpu_id) {
   ASSERT(tss != NULL);
-  return tss;
+  ASSERT(cpu_id >= 0 && cpu_id < CPU_MAX);
+  return &tss[cpu_id];
 }
 
-/* Sets the ring 0 stack pointer in the TSS to point to the end
-   of the thread stack. */
+/* Sets the ring 0 stack pointer in the running CPU's TSS to point
+   to the end of the thread stack. */
 void tss_update(void) {
   ASSERT(tss != NULL);
-  tss->esp0 = (uint8_t*)thread_current() + PGSIZE;
+  tss[cpu_current()->id].esp0 = (uint8_t*)thread_current() + PGSIZE;
 }
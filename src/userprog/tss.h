@@ -5,7 +5,7 @@
 
 struct tss;
 void tss_init(void);
-struct tss* tss_get(void);
+struct tss* tss_get(int cpu_id);
 void tss_update(void);
 
 #endif /* userprog/tss.h */